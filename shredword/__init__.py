@@ -1,4 +1,5 @@
 from .trainer import BPETrainer, UnigramTrainer
+from .encoder import BPEEncoder
 
 __version__ = '0.1.0'
 __author__ = 'Shivendra S'
\ No newline at end of file
@@ -1,5 +1,5 @@
 import ctypes, os, sys, platform, sysconfig
-from ctypes import Structure, c_float, c_int, c_int32, c_uint64, c_size_t, c_char_p, POINTER, c_bool, c_double
+from ctypes import Structure, c_float, c_int, c_int32, c_int64, c_uint32, c_uint64, c_size_t, c_char_p, POINTER, c_bool, c_double
 
 def _get_lib_path():
   pkg_dir = os.path.dirname(__file__)
@@ -31,32 +31,48 @@ else: lib = ctypes.CDLL(_lib_path)
 
 MIN_HEAP_SIZE, MAX_OCCS_PER_MERGE, INITIAL_VOCAB_SIZE, INITIAL_STR_SIZE = 4096, 50000, 256, 4096
 
-class Symbol(Structure): pass
-class WordPos(Structure): pass
 class Corpus(Structure): pass
 class BPEConfig(Structure): pass
 class Trainer(Structure): pass
 class MaxHeap(Structure): pass
 class BIMap(Structure): pass
 class PairKey(Structure): pass
+class BPEAllocStats(Structure): pass
+class BPEEncoder(Structure): pass
+class BPEEncoderStats(Structure): pass
 class UnigramTrainer(Structure): pass
 
-Symbol._fields_ = [("id", c_int32), ("prev", POINTER(Symbol)), ("next", POINTER(Symbol)), ("deleted", c_bool)]
-WordPos._fields_ = [("word_index", c_size_t), ("pos", POINTER(Symbol))]
-Corpus._fields_ = [("words", POINTER(POINTER(Symbol))), ("word_counts", POINTER(c_uint64)), ("vocab_size", c_size_t)]
-BPEConfig._fields_ = [("target_vocab_size", c_size_t), ("unk_id", c_int32), ("character_coverage", c_float), ("min_pair_freq", c_uint64)]
+Corpus._fields_ = [("tokens", POINTER(c_int32)), ("offsets", POINTER(c_size_t)), ("lengths", POINTER(c_uint32)), ("word_counts", POINTER(c_uint64)), ("vocab_size", c_size_t)]
+BPEConfig._fields_ = [("target_vocab_size", c_size_t), ("unk_id", c_int32), ("character_coverage", c_float), ("min_pair_freq", c_uint64), ("verify_every", c_uint32), ("num_threads", c_int32), ("pair_queue", c_int32), ("word_budget", c_size_t), ("min_word_freq", c_uint64), ("multi_merge", c_int32)]
 Trainer._fields_ = [("config", BPEConfig), ("heap", POINTER(MaxHeap)), ("corpus", POINTER(Corpus)), ("bigram_map", POINTER(BIMap)), ("next_token", c_size_t), ("num_merges", c_size_t), ("merge_ops", POINTER(PairKey)), ("token_strs", POINTER(c_char_p)), ("token_freq", POINTER(c_uint64))]
+BPEAllocStats._fields_ = [("delta_allocs", c_uint64), ("delta_blocks", c_uint64), ("delta_resets", c_uint64), ("index_allocs", c_uint64), ("index_blocks", c_uint64)]
+BPEEncoderStats._fields_ = [("cache_hits", c_uint64), ("cache_misses", c_uint64)]
 
 lib.create_trainer.argtypes, lib.create_trainer.restype = [POINTER(BPEConfig)], POINTER(Trainer)
 lib.bpe_trainer_destroy.argtypes, lib.bpe_trainer_destroy.restype = [POINTER(Trainer)], None
 lib.bpe_init.argtypes, lib.bpe_init.restype = [POINTER(Trainer)], None
 lib.bpe_count_bigrams.argtypes, lib.bpe_count_bigrams.restype = [POINTER(Trainer)], None
 lib.bpe_load_corpus.argtypes, lib.bpe_load_corpus.restype = [POINTER(Trainer), c_char_p], c_int
+lib.bpe_build_word_cache.argtypes, lib.bpe_build_word_cache.restype = [c_char_p, c_char_p, c_int32], c_int
+lib.bpe_load_word_cache.argtypes, lib.bpe_load_word_cache.restype = [POINTER(Trainer), c_char_p], c_int
+lib.bpe_load_model.argtypes, lib.bpe_load_model.restype = [POINTER(Trainer), c_char_p], c_int
 lib.bpe_merge_batch.argtypes, lib.bpe_merge_batch.restype = [POINTER(Trainer), c_int], c_int
 lib.bpe_train.argtypes, lib.bpe_train.restype = [POINTER(Trainer)], c_int
+lib.bpe_set_checkpoint.argtypes, lib.bpe_set_checkpoint.restype = [POINTER(Trainer), c_char_p, c_uint32], None
+lib.bpe_set_snapshots.argtypes, lib.bpe_set_snapshots.restype = [POINTER(Trainer), POINTER(c_size_t), c_size_t, c_char_p], c_int
+lib.bpe_save_checkpoint.argtypes, lib.bpe_save_checkpoint.restype = [POINTER(Trainer), c_char_p], c_int
+lib.bpe_resume.argtypes, lib.bpe_resume.restype = [POINTER(Trainer), c_char_p], c_int
+lib.bpe_alloc_stats.argtypes, lib.bpe_alloc_stats.restype = [POINTER(Trainer), POINTER(BPEAllocStats)], None
 lib.bpe_save.argtypes, lib.bpe_save.restype = [POINTER(Trainer), c_char_p, c_char_p], None
 
-lib.trainerCreate.argtypes, lib.trainerCreate.restype = [c_int, c_float, c_int, c_int], POINTER(UnigramTrainer)
+lib.bpe_encoder_create.argtypes, lib.bpe_encoder_create.restype = [c_char_p, c_int32, c_size_t], POINTER(BPEEncoder)
+lib.bpe_encoder_destroy.argtypes, lib.bpe_encoder_destroy.restype = [POINTER(BPEEncoder)], None
+lib.bpe_encode.argtypes, lib.bpe_encode.restype = [POINTER(BPEEncoder), c_char_p, c_size_t, POINTER(c_int32)], c_size_t
+lib.bpe_encode_batch.argtypes, lib.bpe_encode_batch.restype = [POINTER(BPEEncoder), POINTER(c_char_p), POINTER(c_size_t), c_size_t, POINTER(c_int32), POINTER(c_size_t)], c_int
+lib.bpe_decode.argtypes, lib.bpe_decode.restype = [POINTER(BPEEncoder), POINTER(c_int32), c_size_t, c_char_p, c_size_t], c_int64
+lib.bpe_encoder_stats.argtypes, lib.bpe_encoder_stats.restype = [POINTER(BPEEncoder), POINTER(BPEEncoderStats)], None
+
+lib.trainerCreate.argtypes, lib.trainerCreate.restype = [c_int, c_float, c_int, c_int, c_int], POINTER(UnigramTrainer)
 lib.trainerDestroy.argtypes, lib.trainerDestroy.restype = [POINTER(UnigramTrainer)], None
 lib.addTextToTrainer.argtypes, lib.addTextToTrainer.restype = [POINTER(UnigramTrainer), c_char_p], c_bool
 lib.preprocessTexts.argtypes, lib.preprocessTexts.restype = [POINTER(UnigramTrainer)], c_bool
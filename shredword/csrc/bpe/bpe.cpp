@@ -5,6 +5,9 @@
 #include "heap.h"
 #include "histogram.h"
 #include "bpe.h"
+#include "../inc/threads.h"
+#include "../inc/mapfile.h"
+#include "../inc/arena.h"
 
 typedef struct FreqChange {
   uint64_t pair_hash;
@@ -13,52 +16,125 @@ typedef struct FreqChange {
 } FreqChange;
 
 #define FREQ_CHANGE_BUCKETS 1024
+#define FREQ_CHANGE_ARENA_BLOCK  (64 << 10)
 
+/**
+ * per-merge pair deltas. nodes (and the sorted view) come from `pool` & are never
+   freed one by one: the owner resets the arena once the merge has been applied.
+*/
 typedef struct FreqChangeMap {
   FreqChange* buckets[FREQ_CHANGE_BUCKETS];
+  size_t count;   // no of distinct pairs
+  Arena* pool;
 } FreqChangeMap;
 
-static void freq_change_init(FreqChangeMap* map) {
+static void freq_change_init(FreqChangeMap* map, Arena* pool) {
   for (int i = 0; i < FREQ_CHANGE_BUCKETS; i++) map->buckets[i] = NULL;
+  map->count = 0;
+  map->pool = pool;
 }
 
 static void freq_change_add(FreqChangeMap* map, uint64_t pair_hash, int64_t delta) {
-  size_t bucket = pair_hash % FREQ_CHANGE_BUCKETS;
+  size_t bucket = pair_mix(pair_hash) % FREQ_CHANGE_BUCKETS;
   for (FreqChange* fc = map->buckets[bucket]; fc; fc = fc->next) {
     if (fc->pair_hash == pair_hash) {
       fc->delta += delta;
       return;
     }
   }
-  FreqChange* new_fc = (FreqChange*)malloc(sizeof(FreqChange));
+  FreqChange* new_fc = (FreqChange*)arena_alloc(map->pool, sizeof(FreqChange));
   new_fc->pair_hash = pair_hash;
   new_fc->delta = delta;
   new_fc->next = map->buckets[bucket];
   map->buckets[bucket] = new_fc;
+  map->count++;
 }
 
-static void freq_change_free(FreqChangeMap* map) {
+// --- add every delta of `src` into `dst`, `src` keeps its nodes until its pool is reset ---
+static void freq_change_merge(FreqChangeMap* dst, const FreqChangeMap* src) {
   for (int i = 0; i < FREQ_CHANGE_BUCKETS; i++) {
-    FreqChange* fc = map->buckets[i];
-    while (fc) {
-      FreqChange* next = fc->next;
-      free(fc);
-      fc = next;
-    }
-    map->buckets[i] = NULL;
+    for (FreqChange* fc = src->buckets[i]; fc; fc = fc->next) freq_change_add(dst, fc->pair_hash, fc->delta);
   }
 }
 
-uint64_t recompute_freq(PairKey key, Info* info, Trainer* trainer) {
+static int freq_change_cmp(const void* a, const void* b) {
+  uint64_t x = (*(const FreqChange* const*)a)->pair_hash, y = (*(const FreqChange* const*)b)->pair_hash;
+  return x < y ? -1 : x > y;
+}
+
+// --- all changes sorted by packed pair, so queue updates happen in the same order on any thread count ---
+static FreqChange** freq_change_sorted(const FreqChangeMap* map) {
+  FreqChange** arr = (FreqChange**)arena_alloc(map->pool, (map->count ? map->count : 1) * sizeof(FreqChange*));
+  size_t n = 0;
+  for (int i = 0; i < FREQ_CHANGE_BUCKETS; i++) {
+    for (FreqChange* fc = map->buckets[i]; fc; fc = fc->next) arr[n++] = fc;
+  }
+  qsort(arr, n, sizeof(FreqChange*), freq_change_cmp);
+  return arr;
+}
+
+#define BPE_CKPT_MAGIC  0x4B435053u  // "SPCK"
+#define BPE_CKPT_VERSION  1
+
+/**
+ * checkpoint layout (native endianness): header, merge_ops[num_merges],
+   lengths[vocab_size], word_counts[vocab_size], tokens[num_tokens] (words back to back),
+   pairs[num_pairs] in pair id order.
+*/
+typedef struct BPECheckpointHeader {
+  uint32_t magic, version;
+  uint64_t num_merges, vocab_size, num_tokens, num_pairs;
+  int32_t unk_id, reserved;
+} BPECheckpointHeader;
+
+typedef struct BPECheckpointPair {
+  uint64_t key;   // pair_pack(PairKey)
+  uint64_t freq;
+} BPECheckpointPair;
+
+// --- pair selection: the indexed MaxHeap or the BucketQueue, per config.pair_queue ---
+static inline bool use_buckets(const Trainer* trainer) {
+  return trainer->config.pair_queue == PAIR_QUEUE_BUCKET;
+}
+
+static inline void queue_update(Trainer* trainer, PairKey key, uint64_t freq, uint32_t id) {
+  if (use_buckets(trainer)) bq_update(&trainer->buckets, key, freq, id);
+  else heap_update(&trainer->heap, key, freq, id);
+}
+
+static inline void queue_remove(Trainer* trainer, uint32_t id) {
+  if (use_buckets(trainer)) bq_remove(&trainer->buckets, id);
+  else heap_remove(&trainer->heap, id);
+}
+
+static inline BPEHeapEntry queue_pop(Trainer* trainer) {
+  return use_buckets(trainer) ? bq_pop(&trainer->buckets) : heap_pop(&trainer->heap);
+}
+
+static inline int queue_empty(Trainer* trainer) {
+  return use_buckets(trainer) ? bq_empty(&trainer->buckets) : heap_empty(&trainer->heap);
+}
+
+static inline size_t queue_size(const Trainer* trainer) {
+  return use_buckets(trainer) ? trainer->buckets.size : trainer->heap.size;
+}
+
+static inline uint64_t queue_top_freq(Trainer* trainer) {
+  if (use_buckets(trainer)) return bq_top_freq(&trainer->buckets);
+  return heap_empty(&trainer->heap) ? 0 : trainer->heap.data[0].freq;
+}
+
+// full-corpus recount of a single pair, only used by the `verify_every` debug mode
+static uint64_t recompute_freq(PairKey key, Trainer* trainer) {
   if (key.first == trainer->config.unk_id || key.second == trainer->config.unk_id) return 0;
   uint64_t freq = 0;
-  size_t vocab_size = trainer->corpus.vocab_size;
-  for (size_t wi = 0; wi < vocab_size; ++wi) {
-    Symbol* s = trainer->corpus.words[wi];
-    uint64_t count = trainer->corpus.word_counts[wi];
-    while (s && s->next) {
-      if (!s->deleted && !s->next->deleted && s->id == key.first && s->next->id == key.second) freq += count;
-      s = s->next;
+  const Corpus* corpus = &trainer->corpus;
+  for (size_t ai = 0; ai < trainer->num_active; ++ai) {   // dead words hold no pair that can still be merged
+    uint32_t wi = trainer->active_words[ai];
+    const int32_t* toks = corpus->tokens + corpus->offsets[wi];
+    uint32_t len = corpus->lengths[wi];
+    for (uint32_t i = 0; i + 1 < len; ++i) {
+      if (toks[i] == key.first && toks[i + 1] == key.second) freq += corpus->word_counts[wi];
     }
   }
   return freq;
@@ -77,9 +153,25 @@ Trainer* create_trainer(const BPEConfig* config) {
   trainer->config = *config;
   if (trainer->config.character_coverage <= 0.0 || trainer->config.character_coverage >= 1.0) trainer->config.character_coverage = 0.995;
   if (trainer->config.min_pair_freq == 0) trainer->config.min_pair_freq = MIN_PAIR_FREQ;
+  trainer->config.num_threads = resolve_threads(trainer->config.num_threads);
   trainer->num_merges = 0;
+  trainer->verify_mismatches = 0;
   trainer->merge_ops = (PairKey*)malloc(sizeof(PairKey) * trainer->config.target_vocab_size);
+  memset(&trainer->corpus, 0, sizeof(Corpus));
+  memset(&trainer->bigram_map, 0, sizeof(BIMap));
+  memset(&trainer->pair_index, 0, sizeof(PairIndex));
   heap_init(&trainer->heap, MIN_HEAP_SIZE);
+  memset(&trainer->buckets, 0, sizeof(BucketQueue));
+  arena_init(&trainer->delta_arena, FREQ_CHANGE_ARENA_BLOCK);
+  trainer->checkpoint_path = NULL;
+  trainer->checkpoint_every = 0;
+  trainer->snapshot_sizes = NULL;
+  trainer->num_snapshots = 0;
+  trainer->snapshot_prefix = NULL;
+  trainer->active_words = NULL;
+  trainer->num_active = trainer->active_merges = 0;
+  trainer->live_pairs = trainer->pair_compactions = 0;
+  trainer->grouped_merges = trainer->group_rollbacks = 0;
   printf("[INFO]\t BPE trainer initialized. Heap initialized successfully.\n");
   return trainer;
 }
@@ -89,9 +181,20 @@ void bpe_trainer_destroy(Trainer* trainer) {
     fprintf(stderr, "[ERROR]\t No Trainer pointer found to destroy!\n");
     exit(EXIT_FAILURE);
   }
-  free(trainer->corpus.words);
+  free(trainer->corpus.tokens);
+  free(trainer->corpus.offsets);
+  free(trainer->corpus.lengths);
   free(trainer->corpus.word_counts);
+  bimap_free(&trainer->bigram_map);
+  pairidx_free(&trainer->pair_index);
   heap_free(&trainer->heap);
+  bq_free(&trainer->buckets);
+  arena_free(&trainer->delta_arena);
+  free(trainer->merge_ops);
+  free(trainer->checkpoint_path);
+  free(trainer->snapshot_sizes);
+  free(trainer->snapshot_prefix);
+  free(trainer->active_words);
   free(trainer);
 }
 
@@ -102,263 +205,1093 @@ void bpe_init(Trainer* trainer) {
   }
   bimap_free(&trainer->bigram_map);
   bimap_init(&trainer->bigram_map, MIN_HEAP_SIZE);
+  pairidx_free(&trainer->pair_index);
+  pairidx_init(&trainer->pair_index, MIN_HEAP_SIZE);
   heap_free(&trainer->heap);
   heap_init(&trainer->heap, MIN_HEAP_SIZE);
+  bq_free(&trainer->buckets);
+  arena_free(&trainer->delta_arena);
+  arena_init(&trainer->delta_arena, FREQ_CHANGE_ARENA_BLOCK);
   bpe_count_bigrams(trainer);
 }
 
-int bpe_load_corpus(Trainer* trainer, const char* input_path) {
-  if (!trainer || !input_path) {
-    fprintf(stderr, "[ERROR]\t NULL trainer or input path pointers\n");
-    return -1;
+#define WORD_BUDGET_MIN  (4 << 20)  // smallest table budget per loader thread
+#define WORD_BUDGET_CHECK  4096  // new words between two budget checks
+
+/**
+ * word -> count table of one loader thread. with a byte budget it does lossy counting:
+   whenever the table outgrows the budget its rarest words are dropped until it fits in
+   half of it, so frequent words survive & the hapax tail is forgotten as it streams by.
+ * a word dropped & seen again restarts from zero, so kept counts can be low by at most
+   the cutoffs applied so far.
+*/
+typedef struct WordCounter {
+  StrMap map;
+  size_t budget;  // bytes the table may hold, 0 -> unbounded
+  size_t next_check;  // table size at which the budget is checked again
+  uint64_t pruned;  // words dropped so far
+  uint64_t max_pruned;  // largest count among them
+} WordCounter;
+
+static void counter_init(WordCounter* wc, size_t budget) {
+  strmap_init(&wc->map, INITIAL_STR_BUFFER);
+  wc->budget = budget;
+  wc->next_check = WORD_BUDGET_CHECK;
+  wc->pruned = wc->max_pruned = 0;
+}
+
+// --- drop the rarest half (by power-of-two count class) until the table fits in half its budget ---
+static void counter_prune(WordCounter* wc) {
+  while (wc->map.size > 0 && strmap_bytes(&wc->map) > wc->budget / 2) {
+    size_t hist[65] = {0}, acc = 0;
+    for (size_t i = 0; i < wc->map.cap; i++) {
+      if (!wc->map.slots[i].key) continue;
+      uint64_t v = wc->map.slots[i].value;
+      int bits = 0;
+      while (v) bits++, v >>= 1;
+      hist[bits]++;
+    }
+    int b = 0;
+    while (b < 64 && (acc += hist[b]) * 2 < wc->map.size) b++;
+    uint64_t cut = b >= 64 ? UINT64_MAX : (uint64_t)1 << b;   // counts below 2^b go
+    if (cut - 1 > wc->max_pruned) wc->max_pruned = cut - 1;
+    wc->pruned += strmap_prune(&wc->map, cut);
   }
-  StrMap freq_map;
-  strmap_init(&freq_map, INITIAL_STR_BUFFER);
-  FILE* fp = fopen(input_path, "r");
-  if (!fp) {
-    fprintf(stderr, "[ERROR]\t Couldn't open file: %s\n", input_path);
-    strmap_free(&freq_map);
-    return -1;
+  wc->next_check = wc->map.size + WORD_BUDGET_CHECK;
+}
+
+static inline void counter_check(WordCounter* wc) {
+  if (!wc->budget || wc->map.size < wc->next_check) return;
+  if (strmap_bytes(&wc->map) > wc->budget) counter_prune(wc);
+  else wc->next_check = wc->map.size + WORD_BUDGET_CHECK;
+}
+
+// --- count the words of buf[begin, end) straight out of the mapping, no line copies ---
+static void count_chunk(const char* buf, size_t begin, size_t end, WordCounter* wc) {
+  size_t i = begin;
+  while (i < end) {
+    while (i < end && is_word_sep(buf[i])) i++;
+    size_t start = i;
+    while (i < end && !is_word_sep(buf[i])) i++;
+    if (i > start) {
+      strmap_add_n(&wc->map, buf + start, i - start, 1);
+      counter_check(wc);
+    }
   }
-  char* line = (char*)malloc(INITIAL_STR_BUFFER);
-  if (!line) {
-    fprintf(stderr, "[ERROR]\t Memory allocation failed\n");
-    fclose(fp);
-    strmap_free(&freq_map);
-    return -1;
+}
+
+/**
+ @brief Count the words of a mapped corpus into `out` (initialised here), keeping the
+        table under `budget` bytes when it is non-zero.
+ * the buffer is cut into `threads` chunks whose ends are moved forward to the next
+   newline, so no word straddles two chunks. every chunk is counted into a private
+   table (an equal share of the budget) & the tables are folded into the first one in
+   chunk order, under the full budget.
+*/
+static void count_words(const char* buf, size_t size, int threads, size_t budget, WordCounter* out) {
+  threads = threads_for(size, threads, PARALLEL_MIN_BYTES);
+  if (budget) {
+    if (budget < WORD_BUDGET_MIN) budget = WORD_BUDGET_MIN;
+    if ((size_t)threads > budget / WORD_BUDGET_MIN) threads = (int)(budget / WORD_BUDGET_MIN);
   }
-  size_t line_cap = INITIAL_STR_BUFFER;
-  while (fgets(line, line_cap, fp)) {
-    size_t len = strlen(line);
-    while (len == line_cap - 1 && line[len-1] != '\n') {
-      line_cap *= 2;
-      char* new_line = (char*)realloc(line, line_cap);
-      if (!new_line) {
-        fprintf(stderr, "[ERROR]\t Memory reallocation failed\n");
-        free(line);
-        fclose(fp);
-        strmap_free(&freq_map);
-        return -1;
-      }
-      line = new_line;
-      if (!fgets(line + len, line_cap - len, fp)) break;
-      len = strlen(line);
-    }
-    if (len > 0 && line[len-1] == '\n') { line[len-1] = '\0'; }
-    char* tok = strtok(line, "\t\r\n ");
-    while (tok) {
-      strmap_increment(&freq_map, tok);
-      tok = strtok(NULL, "\t\r\n ");
-    }
-  }
-  free(line);
-  fclose(fp);
-  StrMap char_map;
-  strmap_init(&char_map, INITIAL_VOCAB_SIZE);
-  strmap_iter(&freq_map, char_hist, &char_map);
+  if (threads <= 1) {
+    counter_init(out, budget);
+    count_chunk(buf, 0, size, out);
+    return;
+  }
+  size_t* cuts = (size_t*)malloc((threads + 1) * sizeof(size_t));
+  WordCounter* counters = (WordCounter*)calloc(threads, sizeof(WordCounter));
+  if (!cuts || !counters) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate loader chunks\n");
+    exit(EXIT_FAILURE);
+  }
+  cuts[0] = 0, cuts[threads] = size;
+  for (int t = 1; t < threads; t++) {
+    size_t c = size / threads * t;
+    if (c < cuts[t - 1]) c = cuts[t - 1];
+    while (c < size && buf[c] != '\n') c++;
+    cuts[t] = c;
+  }
+  parallel_for((size_t)threads, threads, [&](int, size_t begin, size_t end) {
+    for (size_t t = begin; t < end; t++) {
+      counter_init(&counters[t], budget / threads);
+      count_chunk(buf, cuts[t], cuts[t + 1], &counters[t]);
+    }
+  });
+  *out = counters[0];
+  out->budget = budget;
+  for (int t = 1; t < threads; t++) {
+    WordCounter* wc = &counters[t];
+    for (size_t i = 0; i < wc->map.cap; i++) {
+      if (!wc->map.slots[i].key) continue;
+      strmap_add(&out->map, wc->map.slots[i].key, wc->map.slots[i].value);
+      counter_check(out);
+    }
+    out->pruned += wc->pruned;
+    if (wc->max_pruned > out->max_pruned) out->max_pruned = wc->max_pruned;
+    strmap_free(&wc->map);
+  }
+  free(cuts);
+  free(counters);
+}
+
+// word sources the corpus can be built from: a freshly counted StrMap or a mapped word cache
+typedef void (*WordFn)(const char* word, uint64_t count, void* user);
+typedef void (*WordIter)(const void* src, WordFn fn, void* user);
+
+static void strmap_words(const void* src, WordFn fn, void* user) {
+  strmap_iter((StrMap*)src, fn, user);
+}
+
+/**
+ @brief Fill the trainer's corpus from `n_words` (word, count) pairs produced by `each`.
+ * builds the byte histogram first so `character_coverage` can drop rare bytes,
+   then packs every word's symbols into the flat token array in iteration order.
+*/
+static void build_corpus(Trainer* trainer, WordIter each, const void* src, size_t n_words) {
+  // byte histogram over unique words (same counts char_hist gives), a flat table instead of a map insert per char
+  uint64_t hist[INITIAL_VOCAB_SIZE] = {0};
+  each(src, [](const char* w, uint64_t, void* u) {
+    for (const unsigned char* p = (const unsigned char*)w; *p; ++p) ((uint64_t*)u)[*p]++;
+  }, hist);
   CharCount* counts = (CharCount*)malloc(INITIAL_VOCAB_SIZE * sizeof(CharCount));
   if (!counts) {
     fprintf(stderr, "[ERROR]\t Failed allocation of character counts\n");
     exit(EXIT_FAILURE);
   }
-  CharCountCtx ctx = {counts, 0};
-  strmap_iter(&char_map, collect_char, &ctx);
-  size_t c = ctx.idx;
+  size_t c = 0;
+  for (int b = 1; b < INITIAL_VOCAB_SIZE; b++) {
+    if (hist[b]) counts[c].c = (char)b, counts[c++].count = hist[b];
+  }
   qsort(counts, c, sizeof(CharCount), charcount_cmp);
   printf("[DEBUG]\t Character histogram built with %zu unique characters.\n", c);
   size_t keep = (size_t)(c * trainer->config.character_coverage);
   bool keep_char[INITIAL_VOCAB_SIZE] = {0};
   for (size_t i = 0; i < keep; i++) keep_char[(unsigned char)counts[i].c] = true;
   free(counts);
-  strmap_free(&char_map);
-  size_t N = 0;
-  strmap_iter(&freq_map, [](const char* k, uint64_t v, void* u){(*(size_t*)u)++;}, &N);
+  size_t N = n_words, total_syms = 0;
+  each(src, [](const char* k, uint64_t, void* u){ *(size_t*)u += strlen(k); }, &total_syms);
   trainer->corpus.vocab_size = N;
-  trainer->corpus.words = (Symbol**)malloc(N * sizeof(Symbol*));
-  trainer->corpus.word_counts = (uint64_t*)malloc(N * sizeof(uint64_t));
+  trainer->corpus.tokens = (int32_t*)malloc((total_syms ? total_syms : 1) * sizeof(int32_t));
+  trainer->corpus.offsets = (size_t*)malloc((N + 1) * sizeof(size_t));
+  trainer->corpus.lengths = (uint32_t*)malloc((N ? N : 1) * sizeof(uint32_t));
+  trainer->corpus.word_counts = (uint64_t*)malloc((N ? N : 1) * sizeof(uint64_t));
+  if (!trainer->corpus.tokens || !trainer->corpus.offsets || !trainer->corpus.lengths || !trainer->corpus.word_counts) {
+    fprintf(stderr, "[ERROR]\t Failed allocation of corpus arrays\n");
+    exit(EXIT_FAILURE);
+  }
+  trainer->corpus.offsets[0] = 0;
   size_t idx = 0;
   BuildCtx c_btx = { trainer, &idx, keep_char };
-  strmap_iter(&freq_map, build_symbol_cb, &c_btx);
-  strmap_free(&freq_map);
+  each(src, build_symbol_cb, &c_btx);
   bimap_init(&trainer->bigram_map, MIN_HEAP_SIZE);
+  pairidx_free(&trainer->pair_index);
+  pairidx_init(&trainer->pair_index, MIN_HEAP_SIZE);
+}
+
+int bpe_load_corpus(Trainer* trainer, const char* input_path) {
+  if (!trainer || !input_path) {
+    fprintf(stderr, "[ERROR]\t NULL trainer or input path pointers\n");
+    return -1;
+  }
+  MappedFile mf;
+  if (map_file(input_path, &mf) != 0) return -1;
+  WordCounter wc;
+  count_words(mf.data, mf.size, trainer->config.num_threads, trainer->config.word_budget, &wc);
+  unmap_file(&mf);
+  if (wc.pruned) printf("[INFO]\t Word budget: dropped %llu rare words while counting (counts up to %llu)\n", (unsigned long long)wc.pruned, (unsigned long long)wc.max_pruned);
+  if (trainer->config.min_word_freq > 1) {
+    size_t dropped = strmap_prune(&wc.map, trainer->config.min_word_freq);
+    printf("[INFO]\t Dropped %zu words seen fewer than %llu times\n", dropped, (unsigned long long)trainer->config.min_word_freq);
+  }
+  build_corpus(trainer, strmap_words, &wc.map, wc.map.size);
+  strmap_free(&wc.map);
+  return 0;
+}
+
+#define WORD_CACHE_MAGIC  0x43575053u  // "SPWC"
+#define WORD_CACHE_VERSION  1
+
+/**
+ * word cache layout (native endianness), laid out so the file can be used straight from
+   the mapping: header, counts[num_words], then every word NUL-terminated back to back
+   (blob_size bytes) in the same order as counts.
+*/
+typedef struct WordCacheHeader {
+  uint32_t magic, version;
+  uint64_t num_words, blob_size;
+} WordCacheHeader;
+
+typedef struct WordCacheView {
+  const uint64_t* counts;
+  const char* blob;
+  size_t num_words;
+  uint64_t min_count;  // rows counted fewer times are skipped (min_word_freq)
+} WordCacheView;
+
+static void cache_words(const void* src, WordFn fn, void* user) {
+  const WordCacheView* v = (const WordCacheView*)src;
+  const char* w = v->blob;
+  for (size_t i = 0; i < v->num_words; i++) {
+    if (v->counts[i] >= v->min_count) fn(w, v->counts[i], user);
+    w += strlen(w) + 1;
+  }
+}
+
+typedef struct CacheWriteCtx {
+  FILE* f;
+  uint64_t* counts;
+  size_t n;
+  bool ok;
+} CacheWriteCtx;
+
+/**
+ @brief Count the words of a text corpus once & store the word -> count table in `cache_path`.
+ * words are written in StrMap order, so a trainer loaded from the cache gets the exact
+   corpus (same word order) bpe_load_corpus would have built from the text.
+ * the file is written to `cache_path`.tmp & renamed once complete.
+*/
+int bpe_build_word_cache(const char* input_path, const char* cache_path, int32_t num_threads) {
+  if (!input_path || !cache_path) {
+    fprintf(stderr, "[ERROR]\t NULL input or cache path pointers\n");
+    return -1;
+  }
+  MappedFile mf;
+  if (map_file(input_path, &mf) != 0) return -1;
+  WordCounter wc;
+  count_words(mf.data, mf.size, resolve_threads(num_threads), 0, &wc);
+  unmap_file(&mf);
+  StrMap freq_map = wc.map;
+
+  WordCacheHeader hdr = {WORD_CACHE_MAGIC, WORD_CACHE_VERSION, freq_map.size, 0};
+  strmap_iter(&freq_map, [](const char* k, uint64_t, void* u){ *(uint64_t*)u += strlen(k) + 1; }, &hdr.blob_size);
+  CacheWriteCtx ctx = {NULL, (uint64_t*)malloc((freq_map.size ? freq_map.size : 1) * sizeof(uint64_t)), 0, true};
+  size_t tmp_len = strlen(cache_path) + 5;
+  char* tmp = (char*)malloc(tmp_len);
+  if (!ctx.counts || !tmp) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate word cache buffers\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(tmp, tmp_len, "%s.tmp", cache_path);
+  ctx.f = fopen(tmp, "wb");
+  if (!ctx.f) {
+    fprintf(stderr, "[ERROR]\t Cannot open word cache file: %s\n", tmp);
+    free(ctx.counts);
+    free(tmp);
+    strmap_free(&freq_map);
+    return -1;
+  }
+  strmap_iter(&freq_map, [](const char*, uint64_t v, void* u){ CacheWriteCtx* c = (CacheWriteCtx*)u; c->counts[c->n++] = v; }, &ctx);
+  ctx.ok = fwrite(&hdr, sizeof(hdr), 1, ctx.f) == 1 && (ctx.n == 0 || fwrite(ctx.counts, sizeof(uint64_t), ctx.n, ctx.f) == ctx.n);
+  strmap_iter(&freq_map, [](const char* k, uint64_t, void* u){
+    CacheWriteCtx* c = (CacheWriteCtx*)u;
+    size_t len = strlen(k) + 1;
+    if (c->ok) c->ok = fwrite(k, 1, len, c->f) == len;
+  }, &ctx);
+  ctx.ok = (fclose(ctx.f) == 0) && ctx.ok;
+  free(ctx.counts);
+  strmap_free(&freq_map);
+#ifdef _WIN32
+  if (ctx.ok) remove(cache_path);   // rename doesn't replace an existing file on Windows
+#endif
+  if (!ctx.ok || rename(tmp, cache_path) != 0) {
+    fprintf(stderr, "[ERROR]\t Failed to write word cache %s\n", cache_path);
+    remove(tmp);
+    free(tmp);
+    return -1;
+  }
+  free(tmp);
+  printf("[INFO]\t Word cache saved to %s (%llu unique words)\n", cache_path, (unsigned long long)hdr.num_words);
+  return 0;
+}
+
+// --- build the trainer's corpus from a word cache, skipping the text scan entirely ---
+int bpe_load_word_cache(Trainer* trainer, const char* cache_path) {
+  if (!trainer || !cache_path) {
+    fprintf(stderr, "[ERROR]\t NULL trainer or cache path pointers\n");
+    return -1;
+  }
+  MappedFile mf;
+  if (map_file(cache_path, &mf) != 0) return -1;
+  WordCacheHeader hdr;
+  bool ok = mf.size >= sizeof(hdr);
+  if (ok) {
+    memcpy(&hdr, mf.data, sizeof(hdr));
+    ok = hdr.magic == WORD_CACHE_MAGIC && hdr.version == WORD_CACHE_VERSION
+         && hdr.num_words <= (mf.size - sizeof(hdr)) / sizeof(uint64_t)
+         && mf.size == sizeof(hdr) + hdr.num_words * sizeof(uint64_t) + hdr.blob_size;
+  }
+  WordCacheView view = {NULL, NULL, 0, 0};
+  if (ok) {
+    view.counts = (const uint64_t*)(mf.data + sizeof(hdr));
+    view.blob = mf.data + sizeof(hdr) + hdr.num_words * sizeof(uint64_t);
+    view.num_words = (size_t)hdr.num_words;
+    // every word must end inside the blob, so the walk in cache_words stays in bounds
+    size_t nuls = 0;
+    for (size_t i = 0; i < hdr.blob_size; i++) nuls += view.blob[i] == '\0';
+    ok = nuls == hdr.num_words && (hdr.blob_size == 0 || view.blob[hdr.blob_size - 1] == '\0');
+  }
+  if (!ok) {
+    fprintf(stderr, "[ERROR]\t %s is not a valid word cache\n", cache_path);
+    unmap_file(&mf);
+    return -1;
+  }
+  size_t kept = view.num_words;
+  if (trainer->config.min_word_freq > 1) {
+    view.min_count = trainer->config.min_word_freq;
+    for (size_t i = 0; i < view.num_words; i++) kept -= view.counts[i] < view.min_count;
+    printf("[INFO]\t Dropped %zu words seen fewer than %llu times\n", view.num_words - kept, (unsigned long long)trainer->config.min_word_freq);
+  }
+  build_corpus(trainer, cache_words, &view, kept);
+  unmap_file(&mf);
+  printf("[INFO]\t Loaded %zu unique words from word cache %s\n", kept, cache_path);
+  return 0;
+}
+
+// --- re-apply loaded merges to words [begin, end), `ranks` maps a merged pair to its merge index (Info.id) ---
+static void replay_range(Trainer* trainer, const BIMap* ranks, size_t begin, size_t end) {
+  int32_t unk_id = trainer->config.unk_id;
+  for (size_t wi = begin; wi < end; wi++) {
+    int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[wi];
+    uint32_t len = trainer->corpus.lengths[wi];
+    for (;;) {
+      uint32_t best = UINT32_MAX;
+      for (uint32_t i = 0; i + 1 < len; i++) {
+        if (toks[i] == unk_id || toks[i + 1] == unk_id) continue;
+        PairKey pk = {toks[i], toks[i + 1]};
+        const Info* info = bimap_find(ranks, pk);
+        if (info && info->id < best) best = info->id;
+      }
+      if (best == UINT32_MAX) break;
+      PairKey key = trainer->merge_ops[best];
+      int32_t new_id = INITIAL_VOCAB_SIZE + (int32_t)best;
+      uint32_t r = 0, w = 0;
+      while (r < len) {
+        if (r + 1 < len && toks[r] == key.first && toks[r + 1] == key.second) {
+          toks[w++] = new_id;
+          r += 2;
+        } else {
+          toks[w++] = toks[r++];
+        }
+      }
+      len = w;
+    }
+    trainer->corpus.lengths[wi] = len;
+  }
+}
+
+/**
+ @brief Read a merges file written by bpe_save into `*ops` (capacity >= max(n, min_cap))
+        & `ranks` (initialised here), which maps every merged pair to its merge index.
+ * every record must be (a, b, 256 + i) with a, b existing ids & no pair listed twice.
+ * returns 0 on success, -1 (nothing allocated) on a missing or malformed file.
+*/
+int bpe_read_merges(const char* model_path, size_t min_cap, PairKey** ops_out, size_t* n_out, BIMap* ranks) {
+  MappedFile mf;
+  if (map_file(model_path, &mf) != 0) return -1;
+  size_t rec = 3 * sizeof(int32_t), m = mf.size / rec;
+  if (mf.size % rec != 0) {
+    fprintf(stderr, "[ERROR]\t %s is not a BPE merges file (size %zu)\n", model_path, mf.size);
+    unmap_file(&mf);
+    return -1;
+  }
+  size_t cap = min_cap > m ? min_cap : m;
+  PairKey* ops = (PairKey*)malloc((cap ? cap : 1) * sizeof(PairKey));
+  if (!ops) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate merge list\n");
+    exit(EXIT_FAILURE);
+  }
+  bimap_init(ranks, m * 2);
+  for (size_t i = 0; i < m; i++) {
+    int32_t t[3];
+    memcpy(t, mf.data + i * rec, rec);
+    int32_t new_id = INITIAL_VOCAB_SIZE + (int32_t)i;
+    if (t[2] != new_id || t[0] < 0 || t[1] < 0 || t[0] >= new_id || t[1] >= new_id || bimap_find(ranks, {t[0], t[1]})) {
+      fprintf(stderr, "[ERROR]\t Invalid merge #%zu (%d,%d) -> %d in %s\n", i, t[0], t[1], t[2], model_path);
+      free(ops);
+      bimap_free(ranks);
+      unmap_file(&mf);
+      return -1;
+    }
+    ops[i] = {t[0], t[1]};
+    bimap_get(ranks, ops[i]);  // ids are handed out in insertion order, so id == merge rank
+  }
+  unmap_file(&mf);
+  *ops_out = ops;
+  *n_out = m;
+  return 0;
+}
+
+/**
+ @brief Load the merges file written by bpe_save, so training continues after them.
+ * if a corpus is loaded, the merges are replayed onto it in a single pass over the
+   words: each word repeatedly applies its lowest ranked pair. a merge only creates
+   pairs ranked after itself, so this ends in the same state as running the merges
+   one by one over the whole corpus, but visits every word once instead of once per merge.
+ * call before bpe_train; bpe_init then counts pairs on the merged corpus & training
+   picks up at merge `num_merges` towards a larger target_vocab_size.
+*/
+int bpe_load_model(Trainer* trainer, const char* model_path) {
+  if (!trainer || !model_path) {
+    fprintf(stderr, "[ERROR]\t NULL trainer or model path pointers\n");
+    return -1;
+  }
+  PairKey* ops;
+  size_t m;
+  BIMap ranks;
+  if (bpe_read_merges(model_path, trainer->config.target_vocab_size, &ops, &m, &ranks) != 0) return -1;
+  free(trainer->merge_ops);
+  trainer->merge_ops = ops;
+  trainer->num_merges = m;
+
+  size_t v = trainer->corpus.vocab_size;
+  if (v > 0 && m > 0) {
+    int threads = threads_for(v, trainer->config.num_threads, PARALLEL_MIN_WORDS);
+    printf("[INFO]\t Replaying %zu merges over %zu words on %d thread(s)...\n", m, v, threads);
+    parallel_for(v, threads, [&](int, size_t begin, size_t end) {
+      replay_range(trainer, &ranks, begin, end);
+    });
+  }
+  bimap_free(&ranks);
+  printf("[INFO]\t Loaded %zu merges from %s\n", m, model_path);
   return 0;
 }
 
+// --- count every adjacent pair of words[begin, end) into a (thread-local) map & index, `map` may be NULL ---
+static uint64_t count_range(const Trainer* trainer, const uint32_t* words, size_t begin, size_t end, BIMap* map, PairIndex* idx, bool report) {
+  const Corpus* corpus = &trainer->corpus;
+  int32_t unk_id = trainer->config.unk_id;
+  uint64_t total = 0;
+  for (size_t ai = begin; ai < end; ai++) {
+    uint32_t wi = words[ai];
+    const int32_t* toks = corpus->tokens + corpus->offsets[wi];
+    uint32_t len = corpus->lengths[wi];
+    uint64_t wcount = corpus->word_counts[wi];
+    for (uint32_t i = 0; i + 1 < len; i++) {
+      if (toks[i] == unk_id || toks[i + 1] == unk_id) continue;
+      PairKey key = { toks[i], toks[i + 1] };
+      if (map) bimap_get(map, key)->freq += wcount;
+      total += wcount;
+      pairidx_add(idx, key, wi);
+    }
+    if (report && (ai - begin) % 10000 == 0 && ai > begin) {
+      printf("[DEBUG]\t Processed %zu/%zu words\n", ai - begin, end - begin);
+    }
+  }
+  return total;
+}
+
+// --- restart the active list from every word that still has a pair ---
+static void reset_active(Trainer* trainer) {
+  const Corpus* corpus = &trainer->corpus;
+  free(trainer->active_words);
+  trainer->active_words = (uint32_t*)malloc((corpus->vocab_size ? corpus->vocab_size : 1) * sizeof(uint32_t));
+  if (!trainer->active_words) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate active word list\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t n = 0;
+  for (size_t w = 0; w < corpus->vocab_size; w++) {
+    if (corpus->lengths[w] >= 2) trainer->active_words[n++] = (uint32_t)w;
+  }
+  trainer->num_active = n;
+  trainer->active_merges = trainer->num_merges;
+}
+
+static bool word_is_live(const Trainer* trainer, uint32_t wi) {
+  const int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[wi];
+  uint32_t len = trainer->corpus.lengths[wi];
+  int32_t unk_id = trainer->config.unk_id;
+  for (uint32_t i = 0; i + 1 < len; i++) {
+    if (toks[i] == unk_id || toks[i + 1] == unk_id) continue;
+    const Info* info = bimap_find(&trainer->bigram_map, {toks[i], toks[i + 1]});
+    if (info && info->freq >= trainer->config.min_pair_freq) return true;
+  }
+  return false;
+}
+
+/**
+ @brief Drop the words that can never be merged again from the active list.
+ * a word is dead once it is a single symbol or all of its pairs are below min_pair_freq:
+   a merge only creates pairs holding its new token, so the count of a pair of existing
+   tokens never grows again & no later merge can pick one of that word's pairs.
+ * dead words keep their symbols & counts for bpe_save & checkpoints, the pair scans
+   (bpe_count_bigrams, index rebuilds, verify recounts) just skip them.
+*/
+static void compact_active(Trainer* trainer) {
+  size_t n = 0;
+  for (size_t i = 0; i < trainer->num_active; i++) {
+    uint32_t wi = trainer->active_words[i];
+    if (word_is_live(trainer, wi)) trainer->active_words[n++] = wi;
+  }
+  printf("[DEBUG]\t Active words: %zu -> %zu of %zu\n", trainer->num_active, n, trainer->corpus.vocab_size);
+  trainer->num_active = n;
+  trainer->active_merges = trainer->num_merges;
+}
+
+/**
+ @brief Walk every active word once, adding its pairs to the pair index & (with `count`) to the bigram map.
+ * with `config.num_threads` > 1 the active list is split into contiguous ranges, each
+   thread counts into its own BIMap/PairIndex & the tables are reduced in thread order,
+   so pair counts & index lists come out identical to the single-threaded pass.
+*/
+static uint64_t scan_pairs(Trainer* trainer, bool count) {
+  size_t v = trainer->num_active;
+  const uint32_t* words = trainer->active_words;
+  uint64_t total_pairs = 0;
+  int threads = threads_for(v, trainer->config.num_threads, PARALLEL_MIN_WORDS);
+  printf("[INFO]\t %s bigrams from %zu words on %d thread(s)...\n", count ? "Counting" : "Indexing", v, threads);
+  if (threads <= 1) return count_range(trainer, words, 0, v, count ? &trainer->bigram_map : NULL, &trainer->pair_index, true);
+
+  BIMap* maps = (BIMap*)calloc(threads, sizeof(BIMap));
+  PairIndex* idxs = (PairIndex*)calloc(threads, sizeof(PairIndex));
+  uint64_t* totals = (uint64_t*)calloc(threads, sizeof(uint64_t));
+  if (!maps || !idxs || !totals) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate per-thread bigram tables\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int t = 0; t < threads; t++) {
+    if (count) bimap_init(&maps[t], MIN_HEAP_SIZE);
+    pairidx_init(&idxs[t], MIN_HEAP_SIZE);
+  }
+  parallel_for(v, threads, [&](int t, size_t begin, size_t end) {
+    totals[t] = count_range(trainer, words, begin, end, count ? &maps[t] : NULL, &idxs[t], t == 0);
+  });
+  for (int t = 0; t < threads; t++) {
+    if (count) {
+      bimap_merge(&trainer->bigram_map, &maps[t]);
+      bimap_free(&maps[t]);
+    }
+    pairidx_merge(&trainer->pair_index, &idxs[t]);
+    arena_add_stats(&trainer->pair_index.nodes, &idxs[t].nodes);
+    pairidx_free(&idxs[t]);
+    total_pairs += totals[t];
+  }
+  free(maps);
+  free(idxs);
+  free(totals);
+  return total_pairs;
+}
+
+/**
+ @brief (Re)build the pair queue from every counted pair with freq >= min_pair_freq.
+ * the heap is built in linear time, its order is total so map layout doesn't matter.
+   the bucket queue breaks ties by insertion order, so its seeds go in key order.
+*/
+static void seed_queue(Trainer* trainer) {
+  uint64_t min_freq = trainer->config.min_pair_freq;
+  size_t unique_pairs = 0, heap_entries = 0;
+  uint64_t max_freq = 0;
+  BPEHeapEntry* seeds = (BPEHeapEntry*)malloc((trainer->bigram_map.size ? trainer->bigram_map.size : 1) * sizeof(BPEHeapEntry));
+  if (!seeds) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate queue seeds\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < trainer->bigram_map.cap; i++) {
+    const BIEntry* e = &trainer->bigram_map.slots[i];
+    if (e->key == BIMAP_EMPTY || e->info.freq == 0) continue;
+    unique_pairs++;
+    if (e->info.freq >= min_freq) {
+      seeds[heap_entries++] = {pair_unpack(e->key), e->info.freq, e->info.id};
+      if (e->info.freq > max_freq) max_freq = e->info.freq;
+    }
+  }
+  trainer->live_pairs = unique_pairs;
+  if (use_buckets(trainer)) {
+    qsort(seeds, heap_entries, sizeof(BPEHeapEntry), [](const void* a, const void* b) {
+      uint64_t x = pair_pack(((const BPEHeapEntry*)a)->key), y = pair_pack(((const BPEHeapEntry*)b)->key);
+      return x < y ? -1 : (int)(x > y);
+    });
+    bq_init(&trainer->buckets, max_freq);
+    for (size_t i = 0; i < heap_entries; i++) bq_update(&trainer->buckets, seeds[i].key, seeds[i].freq, seeds[i].id);
+  } else {
+    heap_build(&trainer->heap, seeds, heap_entries);
+  }
+  free(seeds);
+  printf("[INFO]\t Added %zu of %zu unique pairs to %s (freq >= %llu)\n", heap_entries, unique_pairs, use_buckets(trainer) ? "bucket queue" : "heap", (unsigned long long)min_freq);
+}
+
+/**
+ @brief Drop the pairs whose count fell to zero from the bigram map & renumber the rest.
+ * the map keeps every pair ever seen & pair ids index the queue's position arrays, so
+   without this the map, heap pos[] & bucket links stay sized by every pair the run
+   has created while only a fraction is still live.
+ * survivors get fresh dense ids in their old id order (like a checkpoint resume); the
+   heap is rebuilt (its order is total), the bucket queue is renumbered in place so
+   its ties pop in the same order. the pair index is keyed by PairKey & isn't affected.
+*/
+static void compact_pairs(Trainer* trainer) {
+  size_t nids = trainer->bigram_map.size;
+  const BIEntry** by_id = (const BIEntry**)calloc(nids, sizeof(const BIEntry*));
+  uint32_t* remap = (uint32_t*)malloc(nids * sizeof(uint32_t));
+  if (!by_id || !remap) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate pair compaction table\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < trainer->bigram_map.cap; i++) {
+    const BIEntry* e = &trainer->bigram_map.slots[i];
+    if (e->key != BIMAP_EMPTY && e->info.freq > 0) by_id[e->info.id] = e;
+  }
+  BIMap live;
+  bimap_init(&live, trainer->live_pairs * 2);
+  for (size_t i = 0; i < nids; i++) {
+    remap[i] = UINT32_MAX;
+    if (!by_id[i]) continue;
+    Info* info = bimap_get(&live, pair_unpack(by_id[i]->key));
+    info->freq = by_id[i]->info.freq;
+    remap[i] = info->id;
+  }
+  printf("[DEBUG]\t Pair table compacted: %zu -> %zu pairs\n", nids, live.size);
+  bimap_free(&trainer->bigram_map);
+  trainer->bigram_map = live;
+  trainer->pair_compactions++;
+  if (use_buckets(trainer)) {
+    bq_renumber(&trainer->buckets, remap, nids, live.size);
+    trainer->live_pairs = live.size;
+  } else {
+    seed_queue(trainer);
+  }
+  free(by_id);
+  free(remap);
+}
+
+// --- Count all bigrams of the corpus & seed the pair queue ---
 void bpe_count_bigrams(Trainer* trainer) {
   if (!trainer) {
     fprintf(stderr, "[ERROR]\t NULL trainer pointer\n");
     exit(EXIT_FAILURE);
   }
-  size_t v = trainer->corpus.vocab_size;
+  reset_active(trainer);
+  uint64_t total_pairs = scan_pairs(trainer, true);
+  printf("[INFO]\t Counted %llu total bigram occurrences\n", (unsigned long long)total_pairs);
+  seed_queue(trainer);
+  compact_active(trainer);
+}
+
+/**
+ @brief Rewrite (a,b) -> new_id in word `wi`, recording count deltas in `changes`
+        & the word under its new neighbour pairs in `idx`. returns merged occurrences.
+*/
+static uint64_t merge_word(Trainer* trainer, PairKey key, int32_t new_id, uint32_t wi, FreqChangeMap* changes, PairIndex* idx) {
+  int32_t unk_id = trainer->config.unk_id;
+  uint64_t key_hash = pair_pack(key), merged = 0;
+  int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[wi];
+  uint32_t len = trainer->corpus.lengths[wi];
+  uint64_t word_count = trainer->corpus.word_counts[wi];
+  // compact the word in place: `r` reads the old symbols, `w` writes the merged ones,
+  // so toks[w - 1] is the already rewritten left neighbour & toks[r + 2] the untouched right one
+  uint32_t r = 0, w = 0;
+  while (r < len) {
+    if (r + 1 >= len || toks[r] != key.first || toks[r + 1] != key.second) {
+      toks[w++] = toks[r++];
+      continue;
+    }
+    merged += word_count;
+    freq_change_add(changes, key_hash, -(int64_t)word_count);
+    if (w > 0 && toks[w - 1] != unk_id) {
+      PairKey old_left = {toks[w - 1], key.first};
+      PairKey new_left = {toks[w - 1], new_id};
+      freq_change_add(changes, pair_pack(old_left), -(int64_t)word_count);
+      freq_change_add(changes, pair_pack(new_left), (int64_t)word_count);
+      pairidx_add(idx, new_left, wi);
+    }
+    if (r + 2 < len && toks[r + 2] != unk_id) {
+      PairKey old_right = {key.second, toks[r + 2]};
+      PairKey new_right = {new_id, toks[r + 2]};
+      freq_change_add(changes, pair_pack(old_right), -(int64_t)word_count);
+      freq_change_add(changes, pair_pack(new_right), (int64_t)word_count);
+      pairidx_add(idx, new_right, wi);
+    }
+    toks[w++] = new_id;
+    r += 2;
+  }
+  trainer->corpus.lengths[wi] = w;
+  return merged;
+}
+
+/**
+ @brief Rewrite (a,b) -> new_id in the listed words, see merge_word.
+ * only touches the listed words, so disjoint word lists can run on separate threads.
+*/
+static uint64_t merge_words(Trainer* trainer, PairKey key, int32_t new_id, const uint32_t* words, size_t n, FreqChangeMap* changes, PairIndex* idx) {
+  uint64_t merged = 0;
+  for (size_t li = 0; li < n; ++li) merged += merge_word(trainer, key, new_id, words[li], changes, idx);
+  return merged;
+}
+
+/**
+ @brief Apply one merge to every word in `words` (ascending), summing count deltas into `changes`.
+ * large lists are split into contiguous ranges across `config.num_threads`; every thread
+   keeps its own delta map & index, both reduced in thread order. the new pairs only exist
+   in the words of this merge, so the reduced index lists stay ascending & the counts,
+   heap pushes & merges come out the same as the serial path.
+*/
+static uint64_t apply_merge(Trainer* trainer, PairKey key, int32_t new_id, const uint32_t* words, size_t n, FreqChangeMap* changes) {
+  int threads = threads_for(n, trainer->config.num_threads, PARALLEL_MIN_OCCS);
+  if (threads <= 1) return merge_words(trainer, key, new_id, words, n, changes, &trainer->pair_index);
+
+  FreqChangeMap* local_changes = (FreqChangeMap*)malloc(threads * sizeof(FreqChangeMap));
+  Arena* local_pools = (Arena*)malloc(threads * sizeof(Arena));
+  PairIndex* local_idx = (PairIndex*)calloc(threads, sizeof(PairIndex));
+  uint64_t* merged = (uint64_t*)calloc(threads, sizeof(uint64_t));
+  if (!local_changes || !local_pools || !local_idx || !merged) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate per-thread merge state\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int t = 0; t < threads; t++) {
+    arena_init(&local_pools[t], FREQ_CHANGE_ARENA_BLOCK);
+    freq_change_init(&local_changes[t], &local_pools[t]);
+    pairidx_init(&local_idx[t], INITIAL_VOCAB_SIZE);
+  }
+  parallel_for(n, threads, [&](int t, size_t begin, size_t end) {
+    merged[t] = merge_words(trainer, key, new_id, words + begin, end - begin, &local_changes[t], &local_idx[t]);
+  });
+  uint64_t total = 0;
+  for (int t = 0; t < threads; t++) {
+    freq_change_merge(changes, &local_changes[t]);
+    pairidx_merge(&trainer->pair_index, &local_idx[t]);
+    arena_add_stats(&trainer->delta_arena, &local_pools[t]);
+    arena_add_stats(&trainer->pair_index.nodes, &local_idx[t].nodes);
+    arena_free(&local_pools[t]);
+    pairidx_free(&local_idx[t]);
+    total += merged[t];
+  }
+  free(local_changes);
+  free(local_pools);
+  free(local_idx);
+  free(merged);
+  return total;
+}
+
+// --- debug: recount a popped pair over the corpus & compare with its tracked count ---
+static void verify_pair(Trainer* trainer, PairKey key, uint64_t pair_freq) {
+  uint64_t actual_freq = recompute_freq(key, trainer);
+  if (actual_freq != pair_freq) {
+    fprintf(stderr, "[WARNING]\t Pair (%d,%d) tracked freq=%llu but recount=%llu\n", key.first, key.second, (unsigned long long)pair_freq, (unsigned long long)actual_freq);
+    trainer->verify_mismatches++;
+  }
+}
+
+// --- fold one merge's deltas into the pair counts & the queue, in packed pair order ---
+static void apply_deltas(Trainer* trainer, const FreqChangeMap* freq_changes) {
   uint64_t min_freq = trainer->config.min_pair_freq;
-  uint64_t total_pairs = 0;
-  size_t unique_pairs = 0;
-  printf("[INFO]\t Counting bigrams from %zu words...\n", v);
-  for (size_t wi = 0; wi < v; wi++) {
-    Symbol* s = trainer->corpus.words[wi];
-    uint64_t wcount = trainer->corpus.word_counts[wi];
-    while (s && s->next) {
-      if (s->deleted || s->next->deleted || s->id == trainer->config.unk_id || s->next->id == trainer->config.unk_id) {
-        s = s->next;
-        continue;
+  FreqChange** changes = freq_change_sorted(freq_changes);
+  for (size_t i = 0; i < freq_changes->count; i++) {
+    int64_t delta = changes[i]->delta;
+    if (delta == 0) continue;
+    PairKey pk = pair_unpack(changes[i]->pair_hash);
+    Info* pair_info = bimap_get(&trainer->bigram_map, pk);
+    bool was_live = pair_info->freq > 0;
+    if (delta < 0) {
+      uint64_t abs_delta = (uint64_t)(-delta);
+      if (pair_info->freq >= abs_delta) { pair_info->freq -= abs_delta; }
+      else {
+        fprintf(stderr, "[WARNING]\t Pair (%d,%d) count underflow (%llu - %llu)\n", pk.first, pk.second, (unsigned long long)pair_info->freq, (unsigned long long)abs_delta);
+        pair_info->freq = 0;
+      }
+    } else { pair_info->freq += (uint64_t)delta; }
+    if (was_live != (pair_info->freq > 0)) was_live ? trainer->live_pairs-- : trainer->live_pairs++;
+    if (pair_info->freq >= min_freq) queue_update(trainer, pk, pair_info->freq, pair_info->id);
+    else queue_remove(trainer, pair_info->id);
+  }
+}
+
+// --- record a merge whose deltas are applied: log it, retire the pair & take the next id ---
+static void close_merge(Trainer* trainer, PairKey key, uint64_t pair_freq, uint64_t merged, bool verify) {
+  int32_t new_id = INITIAL_VOCAB_SIZE + trainer->num_merges;
+  printf("[MERGE]\t Merging (%d,%d) freq=%llu -> new_id=%d (merge %zu)\n", key.first, key.second, (unsigned long long)pair_freq, new_id, trainer->num_merges + 1);
+  if (trainer->num_merges < trainer->config.target_vocab_size) trainer->merge_ops[trainer->num_merges] = key;
+  Info* info = bimap_get(&trainer->bigram_map, key);
+  if (verify && info->freq != 0) {
+    fprintf(stderr, "[WARNING]\t Merged pair (%d,%d) left with freq=%llu\n", key.first, key.second, (unsigned long long)info->freq);
+    trainer->verify_mismatches++;
+  }
+  if (info->freq) trainer->live_pairs--;
+  info->freq = 0;
+  trainer->num_merges++;
+  printf("[DEBUG]\t Merged %llu occurrences in corpus\n", (unsigned long long)merged);
+}
+
+/**
+ @brief Pop the queue top plus the tops right behind it while their symbols stay disjoint
+        from every pair taken so far, at most `max`. returns the no of pairs in `group`.
+ * disjoint pairs never share an occurrence, so merging one leaves the others' counts &
+   occurrences untouched. the first conflicting top is put back where it was.
+*/
+static int pick_group(Trainer* trainer, BPEHeapEntry* group, int max) {
+  int32_t syms[2 * MERGE_GROUP_MAX];
+  int k = 0, nsyms = 0;
+  while (k < max && !queue_empty(trainer)) {
+    BPEHeapEntry top = queue_pop(trainer);
+    bool clash = false;
+    for (int i = 0; i < nsyms && !clash; i++) clash = syms[i] == top.key.first || syms[i] == top.key.second;
+    if (clash) {
+      queue_update(trainer, top.key, top.freq, top.id);
+      break;
+    }
+    group[k++] = top;
+    syms[nsyms++] = top.key.first;
+    syms[nsyms++] = top.key.second;
+  }
+  return k;
+}
+
+// --- undo merge `key` -> `new_id` in word `wi`, every `new_id` symbol comes from that merge ---
+static void unmerge_word(Trainer* trainer, PairKey key, int32_t new_id, uint32_t wi) {
+  int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[wi];
+  uint32_t len = trainer->corpus.lengths[wi], grown = len;
+  for (uint32_t i = 0; i < len; i++) grown += toks[i] == new_id;
+  trainer->corpus.lengths[wi] = grown;
+  // merges only shrink a word, so its slot still has room for the split symbols
+  for (uint32_t r = len, w = grown; r-- > 0;) {
+    if (toks[r] == new_id) {
+      toks[--w] = key.second;
+      toks[--w] = key.first;
+    } else {
+      toks[--w] = toks[r];
+    }
+  }
+}
+
+/**
+ @brief Apply the merges of `group` (from pick_group) in one walk over their words, then
+        commit them one by one exactly as sequential merging would have.
+ * the word lists of all k pairs are joined into one ascending list with a bit per pair;
+   each word then runs every merge it holds in group order, with its own delta map per
+   merge, so each map is what that merge would have produced on its own. large lists are
+   split over threads like apply_merge.
+ * pair i > 0 is only committed if, after the deltas of 0..i-1 are in, it is again the
+   queue top: a pair created by an earlier merge may now outrank it. on the first miss
+   merges i..k-1 are undone in the words (their new ids only exist there), their lists
+   are put back & index entries of pairs holding their ids are dropped. only the bucket
+   queue's LIFO ties get here: a new pair never outranks, in heap order, the old
+   neighbour pair it came from, & that one would have ended the group.
+ * with `verify_every` the recounts run before the walk, which gives the same numbers:
+   no pair of the group changes another's count.
+*/
+static int merge_group(Trainer* trainer, const BPEHeapEntry* group, int k) {
+  uint32_t verify_every = trainer->config.verify_every;
+  for (int i = 0; i < k; i++) {
+    if (verify_every > 0 && (trainer->num_merges + i) % verify_every == 0) verify_pair(trainer, group[i].key, group[i].freq);
+  }
+  for (int i = k - 1; i > 0; i--) queue_update(trainer, group[i].key, group[i].freq, group[i].id);  // back in their old order
+
+  WordList lists[MERGE_GROUP_MAX];
+  size_t total = 0, heads[MERGE_GROUP_MAX] = {0};
+  for (int i = 0; i < k; i++) {
+    lists[i] = pairidx_take(&trainer->pair_index, group[i].key);
+    total += lists[i].count;
+  }
+  uint32_t* words = (uint32_t*)malloc((total ? total : 1) * sizeof(uint32_t));
+  uint32_t* masks = (uint32_t*)malloc((total ? total : 1) * sizeof(uint32_t));
+  if (!words || !masks) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate merge group word list\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t n = 0;
+  while (true) {  // k-way join of the ascending lists
+    uint32_t w = UINT32_MAX;
+    int from = -1;
+    for (int i = 0; i < k; i++) {
+      if (heads[i] < lists[i].count && (from < 0 || lists[i].words[heads[i]] < w)) w = lists[i].words[heads[i]], from = i;
+    }
+    if (from < 0) break;
+    heads[from]++;
+    if (n > 0 && words[n - 1] == w) masks[n - 1] |= 1u << from;
+    else words[n] = w, masks[n++] = 1u << from;
+  }
+
+  FreqChangeMap changes[MERGE_GROUP_MAX];
+  uint64_t merged[MERGE_GROUP_MAX] = {0};
+  for (int i = 0; i < k; i++) freq_change_init(&changes[i], &trainer->delta_arena);
+  auto walk = [&](size_t begin, size_t end, FreqChangeMap* maps, PairIndex* idx, uint64_t* counts) {
+    for (size_t li = begin; li < end; li++) {
+      for (int i = 0; i < k; i++) {
+        if (masks[li] >> i & 1) counts[i] += merge_word(trainer, group[i].key, (int32_t)(INITIAL_VOCAB_SIZE + trainer->num_merges + i), words[li], &maps[i], idx);
       }
-      PairKey key = { s->id, s->next->id };
-      Info* info = bimap_get(&trainer->bigram_map, key);
-      if (info->freq == 0) {
-        unique_pairs++;
-        info->version = 0;
+    }
+  };
+  int threads = threads_for(n, trainer->config.num_threads, PARALLEL_MIN_OCCS);
+  if (threads <= 1) {
+    walk(0, n, changes, &trainer->pair_index, merged);
+  } else {
+    FreqChangeMap* local_changes = (FreqChangeMap*)malloc(threads * k * sizeof(FreqChangeMap));
+    Arena* local_pools = (Arena*)malloc(threads * sizeof(Arena));
+    PairIndex* local_idx = (PairIndex*)calloc(threads, sizeof(PairIndex));
+    uint64_t* local_merged = (uint64_t*)calloc(threads * k, sizeof(uint64_t));
+    if (!local_changes || !local_pools || !local_idx || !local_merged) {
+      fprintf(stderr, "[ERROR]\t Failed to allocate per-thread merge state\n");
+      exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < threads; t++) {
+      arena_init(&local_pools[t], FREQ_CHANGE_ARENA_BLOCK);
+      for (int i = 0; i < k; i++) freq_change_init(&local_changes[t * k + i], &local_pools[t]);
+      pairidx_init(&local_idx[t], INITIAL_VOCAB_SIZE);
+    }
+    parallel_for(n, threads, [&](int t, size_t begin, size_t end) {
+      walk(begin, end, local_changes + t * k, &local_idx[t], local_merged + t * k);
+    });
+    for (int t = 0; t < threads; t++) {
+      for (int i = 0; i < k; i++) {
+        freq_change_merge(&changes[i], &local_changes[t * k + i]);
+        merged[i] += local_merged[t * k + i];
       }
-      info->freq += wcount;
-      total_pairs += wcount;  
-      s = s->next;
+      pairidx_merge(&trainer->pair_index, &local_idx[t]);
+      arena_add_stats(&trainer->delta_arena, &local_pools[t]);
+      arena_add_stats(&trainer->pair_index.nodes, &local_idx[t].nodes);
+      arena_free(&local_pools[t]);
+      pairidx_free(&local_idx[t]);
     }
-    if (wi % 10000 == 0 && wi > 0) {
-      printf("[DEBUG]\t Processed %zu/%zu words, found %zu unique pairs\n", wi, v, unique_pairs);
+    free(local_changes);
+    free(local_pools);
+    free(local_idx);
+    free(local_merged);
+  }
+
+  int done = 0;
+  for (; done < k; done++) {
+    if (done > 0) {
+      BPEHeapEntry top = queue_pop(trainer);
+      if (top.id != group[done].id) {
+        queue_update(trainer, top.key, top.freq, top.id);
+        printf("[DEBUG]\t Merge group cut at %d of %d: (%d,%d) freq=%llu now outranks (%d,%d)\n", done, k, top.key.first, top.key.second,
+               (unsigned long long)top.freq, group[done].key.first, group[done].key.second);
+        break;
+      }
     }
+    bool verify = verify_every > 0 && trainer->num_merges % verify_every == 0;
+    apply_deltas(trainer, &changes[done]);
+    close_merge(trainer, group[done].key, group[done].freq, merged[done], verify);
+    free(lists[done].words);
   }
-  size_t heap_entries = 0;
-  for (size_t i = 0; i < trainer->bigram_map.nbuckets; i++) {
-    for (BIEntry* e = trainer->bigram_map.buckets[i]; e; e = e->next) {
-      if (e->info.freq >= min_freq) {
-        heap_push(&trainer->heap, e->key, e->info.freq, e->info.version);
-        heap_entries++;
+  if (done < k) {
+    // num_merges has moved on by `done`, so merge i used id base + i - done now
+    int32_t base = (int32_t)(INITIAL_VOCAB_SIZE + trainer->num_merges - done);
+    for (size_t li = 0; li < n; li++) {
+      for (int i = k - 1; i >= done; i--) {
+        if (masks[li] >> i & 1) unmerge_word(trainer, group[i].key, base + i, words[li]);
+      }
+    }
+    for (int i = done; i < k; i++) {
+      WordList* list = pairidx_find(&trainer->pair_index, group[i].key);
+      if (list) {
+        free(list->words);
+        *list = lists[i];
+      } else {
+        free(lists[i].words);
+      }
+      for (int b = 0; b < FREQ_CHANGE_BUCKETS; b++) {
+        for (FreqChange* fc = changes[i].buckets[b]; fc; fc = fc->next) {
+          PairKey pk = pair_unpack(fc->pair_hash);
+          if (pk.first != base + i && pk.second != base + i) continue;
+          WordList stale = pairidx_take(&trainer->pair_index, pk);
+          free(stale.words);
+        }
       }
     }
+    trainer->group_rollbacks++;
   }
-  printf("[INFO]\t Counted %llu total bigram occurrences, %zu unique pairs\n", (unsigned long long)total_pairs, unique_pairs);
-  printf("[INFO]\t Added %zu pairs to heap (freq >= %llu)\n", heap_entries, (unsigned long long)min_freq);
+  if (done > 1) trainer->grouped_merges += done;
+  arena_reset(&trainer->delta_arena);  // drops every FreqChange of the group at once
+  free(words);
+  free(masks);
+  return done;
 }
 
+/**
+ @brief Pop & apply up to `batch_size` merges.
+ * pair counts are maintained exactly through the FreqChangeMap deltas: every merged
+   occurrence removes one (a,b), its old neighbour pairs & adds the new ones. overlapping
+   runs ("aaa") cancel out because the left neighbour of an occurrence is read after the
+   previous occurrence has already been rewritten, and pairs touching `unk_id` are never
+   counted. `config.verify_every` re-counts the popped pair over the whole corpus every
+   N merges to cross-check the bookkeeping.
+ * with `config.multi_merge` runs of non-conflicting top pairs go through merge_group,
+   one walk over their words instead of one per merge, with the same merges as a result.
+*/
 int bpe_merge_batch(Trainer* trainer, int batch_size) {
   if (!trainer) {
     fprintf(stderr, "[ERROR]\t Trainer pointer is NULL!\n");
     return -1;
   }
-  if (heap_empty(&trainer->heap)) {
+  if (queue_empty(trainer)) {
     printf("[INFO]\t Heap is empty, no more merges possible\n");
     return 0;
   }
-  int merges_done = 0, stale_entries = 0;
-  uint64_t min_freq = trainer->config.min_pair_freq;
-  while (merges_done < batch_size && !heap_empty(&trainer->heap)) {
-    BPEHeapEntry top = heap_pop(&trainer->heap);
-    PairKey key = top.key;
-    Info* info = bimap_get(&trainer->bigram_map, key);
-    if (top.version != info->version) {
-      stale_entries++;
-      continue;
-    }
-    uint64_t actual_freq = recompute_freq(key, info, trainer);
-    if (actual_freq != info->freq) {
-      info->freq = actual_freq;
-      info->version++;
-      if (actual_freq >= min_freq) heap_push(&trainer->heap, key, actual_freq, info->version);
-      continue;
+  int merges_done = 0;
+  uint32_t verify_every = trainer->config.verify_every;
+  while (merges_done < batch_size && !queue_empty(trainer)) {
+    BPEHeapEntry top;
+    if (trainer->config.multi_merge && batch_size - merges_done > 1) {
+      BPEHeapEntry group[MERGE_GROUP_MAX];
+      int max = batch_size - merges_done < MERGE_GROUP_MAX ? batch_size - merges_done : MERGE_GROUP_MAX;
+      int k = pick_group(trainer, group, max);
+      if (k > 1) {
+        merges_done += merge_group(trainer, group, k);
+        continue;
+      }
+      top = group[0];
+    } else {
+      top = queue_pop(trainer);
     }
-    if (actual_freq < min_freq) continue;
+    PairKey key = top.key;
+    uint64_t pair_freq = top.freq;  // the queue only holds live pairs with their current freq
+    bool verify = verify_every > 0 && trainer->num_merges % verify_every == 0;
+    if (verify) verify_pair(trainer, key, pair_freq);
     int32_t new_id = INITIAL_VOCAB_SIZE + trainer->num_merges;
-    printf("[MERGE]\t Merging (%d,%d) freq=%llu -> new_id=%d (merge %zu)\n", key.first, key.second, (unsigned long long)actual_freq, new_id, trainer->num_merges + 1);
-    if (trainer->num_merges < trainer->config.target_vocab_size) trainer->merge_ops[trainer->num_merges] = key;
     FreqChangeMap freq_changes;
-    freq_change_init(&freq_changes);
-    uint64_t total_merge_count = 0;
-    for (size_t wi = 0; wi < trainer->corpus.vocab_size; ++wi) {
-      Symbol* s = trainer->corpus.words[wi];
-      uint64_t word_count = trainer->corpus.word_counts[wi];
-      while (s && s->next) {
-        if (s->deleted || s->next->deleted || s->id != key.first || s->next->id != key.second) {
-          s = s->next;
-          continue;
-        }
-        total_merge_count += word_count;
-        if (s->prev && !s->prev->deleted) {
-          PairKey old_left = {s->prev->id, key.first};
-          PairKey new_left = {s->prev->id, new_id};
-          uint64_t old_hash = ((uint64_t)old_left.first << 32) | (uint64_t)old_left.second;
-          uint64_t new_hash = ((uint64_t)new_left.first << 32) | (uint64_t)new_left.second;
-          freq_change_add(&freq_changes, old_hash, -(int64_t)word_count);
-          freq_change_add(&freq_changes, new_hash, (int64_t)word_count);
-        }
-        Symbol* b = s->next;
-        if (b->next && !b->next->deleted) {
-          PairKey old_right = {key.second, b->next->id};
-          PairKey new_right = {new_id, b->next->id};
-          uint64_t old_hash = ((uint64_t)old_right.first << 32) | (uint64_t)old_right.second;
-          uint64_t new_hash = ((uint64_t)new_right.first << 32) | (uint64_t)new_right.second;
-          freq_change_add(&freq_changes, old_hash, -(int64_t)word_count);
-          freq_change_add(&freq_changes, new_hash, (int64_t)word_count);
-        }
-        s->id = new_id;
-        s->next = b->next;
-        if (b->next) { b->next->prev = s; }
-        b->deleted = true;
-      }
-    }
-    for (int i = 0; i < FREQ_CHANGE_BUCKETS; i++) {
-      for (FreqChange* fc = freq_changes.buckets[i]; fc; fc = fc->next) {
-        uint64_t pair_hash = fc->pair_hash;
-        int64_t delta = fc->delta;
-        PairKey pk = {(int32_t)(pair_hash >> 32), (int32_t)(pair_hash & 0xFFFFFFFF)};
-        if (pk.first == key.first && pk.second == key.second) continue;
-        Info* pair_info = bimap_get(&trainer->bigram_map, pk);
-        if (delta < 0) {
-          uint64_t abs_delta = (uint64_t)(-delta);
-          if (pair_info->freq >= abs_delta) { pair_info->freq -= abs_delta; } else { pair_info->freq = 0; }
-        } else { pair_info->freq += (uint64_t)delta; }
-        if (pair_info->freq >= min_freq) {
-          pair_info->version++;
-          heap_push(&trainer->heap, pk, pair_info->freq, pair_info->version);
-        }
-      }
-    }
-    freq_change_free(&freq_changes);
-    info->freq = 0;
-    info->version++;
-    trainer->num_merges++;
+    freq_change_init(&freq_changes, &trainer->delta_arena);
+    WordList occ = pairidx_take(&trainer->pair_index, key);
+    uint64_t total_merge_count = apply_merge(trainer, key, new_id, occ.words, occ.count, &freq_changes);
+    free(occ.words);
+    apply_deltas(trainer, &freq_changes);
+    arena_reset(&trainer->delta_arena);  // drops every FreqChange of this merge at once
+    close_merge(trainer, key, pair_freq, total_merge_count, verify);
     merges_done++;
-    printf("[DEBUG]\t Merged %llu occurrences in corpus\n", (unsigned long long)total_merge_count);
   }
-  if (stale_entries > 0) { printf("[DEBUG]\t Skipped %d stale heap entries\n", stale_entries); }
+  if (trainer->num_merges - trainer->active_merges >= ACTIVE_COMPACT_EVERY) compact_active(trainer);
+  size_t pairs = trainer->bigram_map.size;
+  if (pairs >= PAIR_COMPACT_MIN && (pairs - trainer->live_pairs) * 100 > pairs * PAIR_COMPACT_DEAD_PCT) compact_pairs(trainer);
   return merges_done;
 }
 
-void free_deleted_symbols(Trainer* trainer) {
-  if (!trainer) return;
-  for (size_t wi = 0; wi < trainer->corpus.vocab_size; ++wi) {
-    Symbol* s = trainer->corpus.words[wi];
-    Symbol* prev = NULL;
-    while (s) {
-      if (s->deleted) {
-        Symbol* to_free = s;
-        if (prev) { prev->next = s->next; } else { trainer->corpus.words[wi] = s->next; }
-        if (s->next) { s->next->prev = prev; }
-        s = s->next;
-        free(to_free);
-      } else {
-        prev = s;
-        s = s->next;
-      }
-    }
+// --- save model & vocab of the current state as <prefix>_<size>.bin / <prefix>_<size>.vocab ---
+static void write_snapshot(const Trainer* trainer, size_t size) {
+  size_t len = strlen(trainer->snapshot_prefix) + 32;
+  char* model = (char*)malloc(len);
+  char* vocab = (char*)malloc(len);
+  if (!model || !vocab) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate snapshot paths\n");
+    exit(EXIT_FAILURE);
   }
+  snprintf(model, len, "%s_%zu.bin", trainer->snapshot_prefix, size);
+  snprintf(vocab, len, "%s_%zu.vocab", trainer->snapshot_prefix, size);
+  printf("[INFO]\t Vocab size %zu reached, writing snapshot\n", size);
+  bpe_save(trainer, model, vocab);
+  free(model);
+  free(vocab);
 }
 
-int bpe_train(Trainer* trainer) {
-  if (!trainer) {
-    fprintf(stderr, "[ERROR]\t Trainer pointer is NULL!\n");
-    return -1;
-  }
-  printf("[INFO]\t Starting BPE training (target vocab size: %zu)\n", trainer->config.target_vocab_size);  
-  bpe_init(trainer);
+/**
+ @brief Run merge batches until `num_merges` reaches the target or the queue runs dry.
+ * with a checkpoint path set (bpe_set_checkpoint) the state is written every
+   `checkpoint_every` merges, always between batches so the file is consistent.
+ * snapshot sizes (bpe_set_snapshots) cut batches short so each one is saved at
+   exactly that vocab size; token freqs come from the corpus at that point.
+*/
+static int run_merges(Trainer* trainer) {
   int total_merges = 0;
-  int target_merges = (int)trainer->config.target_vocab_size - INITIAL_VOCAB_SIZE;
+  int target_merges = (int)trainer->config.target_vocab_size - INITIAL_VOCAB_SIZE - (int)trainer->num_merges;
+  size_t last_checkpoint = trainer->num_merges;
+  size_t next_snapshot = 0;   // snapshots at or below the current size were written by an earlier run
+  while (next_snapshot < trainer->num_snapshots && trainer->snapshot_sizes[next_snapshot] <= INITIAL_VOCAB_SIZE + trainer->num_merges) next_snapshot++;
   printf("[INFO]\t Need to perform %d merges to reach target vocab size\n", target_merges);
   while (total_merges < target_merges) {
-    if (heap_empty(&trainer->heap)) {
+    if (queue_empty(trainer)) {
       printf("[INFO]\t Heap exhausted, stopping training\n");
       break;
     }
-    BPEHeapEntry top = trainer->heap.data[0];
-    uint64_t top_freq = top.freq;
+    uint64_t top_freq = queue_top_freq(trainer);
     int batch_size;
     if (top_freq > 50000) batch_size = 10;
     else if (top_freq > 20000) batch_size = 5;
@@ -366,25 +1299,313 @@ int bpe_train(Trainer* trainer) {
     else if (top_freq > 5000) batch_size = 2;
     else batch_size = 1;
     batch_size = (batch_size > target_merges - total_merges) ? target_merges - total_merges : batch_size;
-    printf("[INFO]\t Processing batch of %d merges (completed: %d/%d, heap size: %zu, top freq: %llu)\n", batch_size, total_merges, target_merges, trainer->heap.size, (unsigned long long)top_freq);
+    if (next_snapshot < trainer->num_snapshots) {   // never step over a snapshot size
+      size_t until = trainer->snapshot_sizes[next_snapshot] - INITIAL_VOCAB_SIZE - trainer->num_merges;
+      if ((size_t)batch_size > until) batch_size = (int)until;
+    }
+    size_t pairs = trainer->bigram_map.size;
+    printf("[INFO]\t Processing batch of %d merges (completed: %d/%d, heap size: %zu, live pairs: %zu/%zu (%.0f%% dead), top freq: %llu)\n", batch_size, total_merges, target_merges,
+           queue_size(trainer), trainer->live_pairs, pairs, pairs ? 100.0 * (pairs - trainer->live_pairs) / pairs : 0.0, (unsigned long long)top_freq);
     int merged = bpe_merge_batch(trainer, batch_size);
     if (merged <= 0) {
       printf("[WARNING]\t No merges performed, stopping\n");
       break;
     }
     total_merges += merged;
-    if (total_merges % 100 == 0) {
-      printf("[DEBUG]\t Cleaning up deleted symbols after %d merges\n", total_merges);
-      free_deleted_symbols(trainer);
-    }
     if (total_merges % 50 == 0 || merged < batch_size) { printf("[PROGRESS]\t Completed %d/%d merges (%.1f%%)\n", total_merges, target_merges, 100.0 * total_merges / target_merges); }
+    if (next_snapshot < trainer->num_snapshots && trainer->snapshot_sizes[next_snapshot] == INITIAL_VOCAB_SIZE + trainer->num_merges) {
+      write_snapshot(trainer, trainer->snapshot_sizes[next_snapshot]);
+      next_snapshot++;
+    }
+    if (trainer->checkpoint_path && trainer->checkpoint_every && trainer->num_merges - last_checkpoint >= trainer->checkpoint_every) {
+      if (bpe_save_checkpoint(trainer, trainer->checkpoint_path) == 0) last_checkpoint = trainer->num_merges;
+    }
+  }
+  for (; next_snapshot < trainer->num_snapshots; next_snapshot++) {
+    printf("[WARNING]\t Training stopped at vocab size %zu, snapshot %zu not written\n", INITIAL_VOCAB_SIZE + trainer->num_merges, trainer->snapshot_sizes[next_snapshot]);
   }
-  printf("[INFO]\t Final cleanup of deleted symbols\n");
-  free_deleted_symbols(trainer);
   printf("[INFO]\t Training completed. Performed %d merges\n", total_merges);
+  BPEAllocStats stats;
+  bpe_alloc_stats(trainer, &stats);
+  printf("[DEBUG]\t Arena: %llu delta nodes from %llu blocks (%llu resets), %llu index nodes from %llu blocks\n",
+         (unsigned long long)stats.delta_allocs, (unsigned long long)stats.delta_blocks, (unsigned long long)stats.delta_resets,
+         (unsigned long long)stats.index_allocs, (unsigned long long)stats.index_blocks);
   return total_merges;
 }
 
+int bpe_train(Trainer* trainer) {
+  if (!trainer) {
+    fprintf(stderr, "[ERROR]\t Trainer pointer is NULL!\n");
+    return -1;
+  }
+  printf("[INFO]\t Starting BPE training (target vocab size: %zu)\n", trainer->config.target_vocab_size);  
+  bpe_init(trainer);
+  return run_merges(trainer);
+}
+
+// --- write a checkpoint every `every` merges of bpe_train/bpe_resume to `path` (NULL -> off) ---
+void bpe_set_checkpoint(Trainer* trainer, const char* path, uint32_t every) {
+  if (!trainer) {
+    fprintf(stderr, "[ERROR]\t Trainer pointer is NULL!\n");
+    return;
+  }
+  free(trainer->checkpoint_path);
+  trainer->checkpoint_path = path ? strdup(path) : NULL;
+  trainer->checkpoint_every = every;
+}
+
+static int size_cmp(const void* a, const void* b) {
+  size_t x = *(const size_t*)a, y = *(const size_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+ @brief Save model+vocab every time the run reaches one of `sizes` (any order, duplicates
+        & sizes outside (INITIAL_VOCAB_SIZE, target] are dropped). n = 0 turns it off.
+ * merge lists are prefix-closed, so one run to the largest size yields all smaller models.
+*/
+int bpe_set_snapshots(Trainer* trainer, const size_t* sizes, size_t n, const char* prefix) {
+  if (!trainer || (n > 0 && (!sizes || !prefix))) {
+    fprintf(stderr, "[ERROR]\t Trainer, snapshot sizes or prefix is NULL!\n");
+    return -1;
+  }
+  free(trainer->snapshot_sizes);
+  free(trainer->snapshot_prefix);
+  trainer->snapshot_sizes = NULL;
+  trainer->snapshot_prefix = NULL;
+  trainer->num_snapshots = 0;
+  if (n == 0) return 0;
+  trainer->snapshot_sizes = (size_t*)malloc(n * sizeof(size_t));
+  trainer->snapshot_prefix = strdup(prefix);
+  if (!trainer->snapshot_sizes || !trainer->snapshot_prefix) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate snapshot list\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (sizes[i] > INITIAL_VOCAB_SIZE && sizes[i] <= trainer->config.target_vocab_size) trainer->snapshot_sizes[trainer->num_snapshots++] = sizes[i];
+    else printf("[WARNING]\t Snapshot size %zu outside (%d, %zu], ignored\n", sizes[i], INITIAL_VOCAB_SIZE, trainer->config.target_vocab_size);
+  }
+  qsort(trainer->snapshot_sizes, trainer->num_snapshots, sizeof(size_t), size_cmp);
+  size_t w = 0;
+  for (size_t i = 0; i < trainer->num_snapshots; i++) {
+    if (w == 0 || trainer->snapshot_sizes[w - 1] != trainer->snapshot_sizes[i]) trainer->snapshot_sizes[w++] = trainer->snapshot_sizes[i];
+  }
+  trainer->num_snapshots = w;
+  return 0;
+}
+
+static bool write_all(FILE* f, const void* data, size_t size, size_t n) {
+  return n == 0 || fwrite(data, size, n, f) == n;
+}
+
+/**
+ @brief Write the training state to `path`: merges so far, the word table in its
+        merged state (compacted, gaps left by merges are dropped) & the live pair counts.
+ * written to `path`.tmp first & renamed, so a crash mid-write keeps the previous checkpoint.
+ * the pair index & queue aren't stored, bpe_resume rebuilds them in one pass over the words.
+*/
+int bpe_save_checkpoint(const Trainer* trainer, const char* path) {
+  if (!trainer || !path) {
+    fprintf(stderr, "[ERROR]\t Trainer or checkpoint path is NULL!\n");
+    return -1;
+  }
+  const Corpus* corpus = &trainer->corpus;
+  BPECheckpointHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = BPE_CKPT_MAGIC;
+  hdr.version = BPE_CKPT_VERSION;
+  hdr.num_merges = trainer->num_merges;
+  hdr.vocab_size = corpus->vocab_size;
+  hdr.unk_id = trainer->config.unk_id;
+  for (size_t w = 0; w < corpus->vocab_size; w++) hdr.num_tokens += corpus->lengths[w];
+  // ids are dense, so slotting pairs by id writes them in id order & a resumed map
+  // hands out ids in the same relative order
+  size_t nids = trainer->bigram_map.size;
+  BPECheckpointPair* pairs = (BPECheckpointPair*)calloc(nids ? nids : 1, sizeof(BPECheckpointPair));
+  if (!pairs) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate checkpoint pair table\n");
+    return -1;
+  }
+  for (size_t i = 0; i < trainer->bigram_map.cap; i++) {
+    const BIEntry* e = &trainer->bigram_map.slots[i];
+    if (e->key == BIMAP_EMPTY || e->info.freq == 0) continue;
+    pairs[e->info.id].key = e->key;
+    pairs[e->info.id].freq = e->info.freq;
+    hdr.num_pairs++;
+  }
+
+  size_t tmp_len = strlen(path) + 5;
+  char* tmp = (char*)malloc(tmp_len);
+  snprintf(tmp, tmp_len, "%s.tmp", path);
+  FILE* f = fopen(tmp, "wb");
+  if (!f) {
+    fprintf(stderr, "[ERROR]\t Cannot open checkpoint file: %s\n", tmp);
+    free(tmp);
+    free(pairs);
+    return -1;
+  }
+  bool ok = write_all(f, &hdr, sizeof(hdr), 1)
+            && write_all(f, trainer->merge_ops, sizeof(PairKey), trainer->num_merges)
+            && write_all(f, corpus->lengths, sizeof(uint32_t), corpus->vocab_size)
+            && write_all(f, corpus->word_counts, sizeof(uint64_t), corpus->vocab_size);
+  for (size_t w = 0; ok && w < corpus->vocab_size; w++) ok = write_all(f, corpus->tokens + corpus->offsets[w], sizeof(int32_t), corpus->lengths[w]);
+  for (size_t i = 0; ok && i < nids; i++) {
+    if (pairs[i].freq > 0) ok = write_all(f, &pairs[i], sizeof(BPECheckpointPair), 1);
+  }
+  ok = (fclose(f) == 0) && ok;
+  free(pairs);
+#ifdef _WIN32
+  if (ok) remove(path);   // rename doesn't replace an existing file on Windows
+#endif
+  if (!ok || rename(tmp, path) != 0) {
+    fprintf(stderr, "[ERROR]\t Failed to write checkpoint %s\n", path);
+    remove(tmp);
+    free(tmp);
+    return -1;
+  }
+  free(tmp);
+  printf("[INFO]\t Checkpoint saved to %s (%zu merges, %zu words, %llu pairs)\n", path, trainer->num_merges, corpus->vocab_size, (unsigned long long)hdr.num_pairs);
+  return 0;
+}
+
+// --- restore the state written by bpe_save_checkpoint, then rebuild the index & queue ---
+static int load_checkpoint(Trainer* trainer, const char* path) {
+  MappedFile mf;
+  if (map_file(path, &mf) != 0) return -1;
+  BPECheckpointHeader hdr;
+  if (mf.size < sizeof(hdr) || (memcpy(&hdr, mf.data, sizeof(hdr)), hdr.magic != BPE_CKPT_MAGIC || hdr.version != BPE_CKPT_VERSION)) {
+    fprintf(stderr, "[ERROR]\t %s is not a BPE checkpoint (or an unsupported version)\n", path);
+    unmap_file(&mf);
+    return -1;
+  }
+  if (hdr.unk_id != trainer->config.unk_id) {
+    fprintf(stderr, "[ERROR]\t Checkpoint was written with unk_id=%d, trainer has unk_id=%d\n", hdr.unk_id, trainer->config.unk_id);
+    unmap_file(&mf);
+    return -1;
+  }
+  // the sections must fill the file exactly; every count is checked against the bytes
+  // left before it's multiplied, so a corrupt header can't overflow a size or an allocation
+  size_t left = mf.size - sizeof(hdr), row = sizeof(uint32_t) + sizeof(uint64_t);
+  bool ok = hdr.num_merges <= left / sizeof(PairKey);
+  if (ok) left -= (size_t)hdr.num_merges * sizeof(PairKey), ok = hdr.vocab_size <= left / row;
+  if (ok) left -= (size_t)hdr.vocab_size * row, ok = hdr.num_tokens <= left / sizeof(int32_t);
+  if (ok) left -= (size_t)hdr.num_tokens * sizeof(int32_t), ok = left % sizeof(BPECheckpointPair) == 0 && hdr.num_pairs == left / sizeof(BPECheckpointPair);
+  if (!ok) {
+    fprintf(stderr, "[ERROR]\t Checkpoint %s is truncated or corrupt\n", path);
+    unmap_file(&mf);
+    return -1;
+  }
+
+  // read into local buffers, the trainer is only touched once the whole file checks out
+  size_t m = (size_t)hdr.num_merges, v = (size_t)hdr.vocab_size, n = (size_t)hdr.num_tokens;
+  size_t cap = trainer->config.target_vocab_size > m ? trainer->config.target_vocab_size : m;
+  PairKey* ops = (PairKey*)malloc((cap ? cap : 1) * sizeof(PairKey));
+  Corpus c;
+  c.vocab_size = v;
+  c.tokens = (int32_t*)malloc((n ? n : 1) * sizeof(int32_t));
+  c.offsets = (size_t*)malloc((v + 1) * sizeof(size_t));
+  c.lengths = (uint32_t*)malloc((v ? v : 1) * sizeof(uint32_t));
+  c.word_counts = (uint64_t*)malloc((v ? v : 1) * sizeof(uint64_t));
+  if (!ops || !c.tokens || !c.offsets || !c.lengths || !c.word_counts) {
+    fprintf(stderr, "[ERROR]\t Failed allocation while loading checkpoint %s\n", path);
+    free(ops), free(c.tokens), free(c.offsets), free(c.lengths), free(c.word_counts);
+    unmap_file(&mf);
+    return -1;
+  }
+  const char* p = mf.data + sizeof(hdr);
+  memcpy(ops, p, m * sizeof(PairKey)), p += m * sizeof(PairKey);
+  memcpy(c.lengths, p, v * sizeof(uint32_t)), p += v * sizeof(uint32_t);
+  memcpy(c.word_counts, p, v * sizeof(uint64_t)), p += v * sizeof(uint64_t);
+  memcpy(c.tokens, p, n * sizeof(int32_t)), p += n * sizeof(int32_t);
+  c.offsets[0] = 0;
+  for (size_t w = 0; ok && w < v; w++) {
+    c.offsets[w + 1] = c.offsets[w] + c.lengths[w];
+    ok = c.offsets[w + 1] <= n;
+  }
+  ok = ok && c.offsets[v] == n;
+
+  // ids index the token tables in bpe_save & the pair index, so check them like bpe_read_merges does:
+  // merge i may only use ids below its own, tokens & pairs only ids that exist (or the dropped-byte unk_id)
+  int64_t id_limit = INITIAL_VOCAB_SIZE + (int64_t)m;
+  int32_t unk_id = trainer->config.unk_id;
+  for (size_t i = 0; ok && i < m; i++) {
+    int64_t new_id = INITIAL_VOCAB_SIZE + (int64_t)i;
+    ok = ops[i].first >= 0 && ops[i].second >= 0 && ops[i].first < new_id && ops[i].second < new_id;
+  }
+  for (size_t i = 0; ok && i < n; i++) {
+    int32_t t = c.tokens[i];
+    ok = (t >= 0 && t < id_limit) || (t < 0 && t == unk_id);
+  }
+  BIMap pairs;
+  bimap_init(&pairs, MIN_HEAP_SIZE);
+  for (uint64_t i = 0; ok && i < hdr.num_pairs; i++) {
+    BPECheckpointPair pr;
+    memcpy(&pr, p, sizeof(pr)), p += sizeof(pr);
+    PairKey key = pair_unpack(pr.key);
+    ok = key.first >= 0 && key.second >= 0 && key.first < id_limit && key.second < id_limit
+         && key.first != unk_id && key.second != unk_id;
+    if (ok) bimap_get(&pairs, key)->freq = pr.freq;
+  }
+  unmap_file(&mf);
+  if (!ok) {
+    fprintf(stderr, "[ERROR]\t Checkpoint %s is truncated or corrupt\n", path);
+    free(ops), free(c.tokens), free(c.offsets), free(c.lengths), free(c.word_counts);
+    bimap_free(&pairs);
+    return -1;
+  }
+
+  Corpus* corpus = &trainer->corpus;
+  free(trainer->merge_ops);
+  trainer->merge_ops = ops;
+  free(corpus->tokens), free(corpus->offsets), free(corpus->lengths), free(corpus->word_counts);
+  *corpus = c;
+  bimap_free(&trainer->bigram_map);
+  trainer->bigram_map = pairs;
+  trainer->num_merges = m;
+  pairidx_free(&trainer->pair_index);
+  pairidx_init(&trainer->pair_index, MIN_HEAP_SIZE);
+  heap_free(&trainer->heap);
+  heap_init(&trainer->heap, MIN_HEAP_SIZE);
+  bq_free(&trainer->buckets);
+  arena_free(&trainer->delta_arena);
+  arena_init(&trainer->delta_arena, FREQ_CHANGE_ARENA_BLOCK);
+  reset_active(trainer);
+  compact_active(trainer);  // the loaded counts already tell which words are dead, skip them in the index
+  scan_pairs(trainer, false);
+  seed_queue(trainer);
+  printf("[INFO]\t Resumed from %s: %zu merges, %zu words, %llu live pairs\n", path, trainer->num_merges, v, (unsigned long long)hdr.num_pairs);
+  return 0;
+}
+
+/**
+ @brief Continue an interrupted run from a checkpoint, no corpus reload needed.
+ * with the heap engine the resumed run produces the same merges as one that was
+   never interrupted; the bucket engine's LIFO ties may pick differently.
+ * returns the no of merges performed by this call, -1 on error.
+*/
+int bpe_resume(Trainer* trainer, const char* checkpoint_path) {
+  if (!trainer || !checkpoint_path) {
+    fprintf(stderr, "[ERROR]\t Trainer or checkpoint path is NULL!\n");
+    return -1;
+  }
+  printf("[INFO]\t Resuming BPE training from %s (target vocab size: %zu)\n", checkpoint_path, trainer->config.target_vocab_size);
+  if (load_checkpoint(trainer, checkpoint_path) != 0) return -1;
+  return run_merges(trainer);
+}
+
+// --- allocation counters of the trainer's arenas since the last bpe_init ---
+void bpe_alloc_stats(const Trainer* trainer, BPEAllocStats* stats) {
+  if (!trainer || !stats) {
+    fprintf(stderr, "[ERROR]\t NULL trainer or stats pointer\n");
+    return;
+  }
+  stats->delta_allocs = trainer->delta_arena.allocs;
+  stats->delta_blocks = trainer->delta_arena.blocks;
+  stats->delta_resets = trainer->delta_arena.resets;
+  stats->index_allocs = trainer->pair_index.nodes.allocs;
+  stats->index_blocks = trainer->pair_index.nodes.blocks;
+}
+
 void bpe_save(const Trainer* trainer, const char* model_path, const char* vocab_path) {
   if (!trainer) {
     fprintf(stderr, "[ERROR]\t Trainer pointer is NULL!\n");
@@ -409,8 +1630,9 @@ void bpe_save(const Trainer* trainer, const char* model_path, const char* vocab_
   uint64_t* freq = (uint64_t*)calloc(T, sizeof(uint64_t));
   for (size_t w = 0; w < trainer->corpus.vocab_size; ++w) {
     uint64_t wc = trainer->corpus.word_counts[w];
-    for (Symbol* s = trainer->corpus.words[w]; s; s = s->next) {
-      if (!s->deleted) freq[s->id] += wc;
+    const int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[w];
+    for (uint32_t i = 0; i < trainer->corpus.lengths[w]; ++i) {
+      if (toks[i] >= 0) freq[toks[i]] += wc;
     }
   }
   FILE* vf = fopen(vocab_path, "w");
@@ -4,9 +4,9 @@
       with help of hashing & heaps for faster merges.
   * main entry point file code for BPE-trainer related codebase.
   * compile it as:
-    *- '.so': g++ -shared -fPIC -o libbpe.so bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp
-    *- '.dll': g++ -shared -o libbpe.dll bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp
-    *- '.dylib': g++ -dynamiclib -o libbpe.dylib bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp
+    *- '.so': g++ -shared -fPIC -o libbpe.so bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp bpe/index.cpp bpe/bucket.cpp -pthread
+    *- '.dll': g++ -shared -o libbpe.dll bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp bpe/index.cpp bpe/bucket.cpp
+    *- '.dylib': g++ -dynamiclib -o libbpe.dylib bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp bpe/index.cpp bpe/bucket.cpp
 */
 
 #ifndef __BPE__H__
@@ -15,27 +15,35 @@
 #include <stdint.h>
 #include "heap.h"
 #include "hash.h"
+#include "index.h"
+#include "bucket.h"
+#include "../inc/arena.h"
 
 #define  MIN_HEAP_SIZE  4096
 #define  INITIAL_VOCAB_SIZE  256  // UTF-8 base chars from 0 -> 255
 #define  INITIAL_STR_BUFFER  4096  // no of characters to be loaded
 #define  MAX_OCCS_PER_MERGE  50000
 #define  MIN_PAIR_FREQ  2000
+#define  PARALLEL_MIN_WORDS  4096  // min words per counting thread, smaller corpora stay serial
+#define  PARALLEL_MIN_OCCS  2048  // min words per thread before a single merge is applied in parallel
+#define  PARALLEL_MIN_BYTES  (4 << 20)  // min corpus bytes per loader thread
+#define  ACTIVE_COMPACT_EVERY  1000  // merges between two compactions of the active word list
+#define  PAIR_COMPACT_MIN  (1 << 16)  // bigram maps smaller than this are never compacted
+#define  PAIR_COMPACT_DEAD_PCT  50  // compact the bigram map once more than this % of its pairs are dead
+#define  MERGE_GROUP_MAX  16  // max pairs applied in one walk with multi_merge (bits of a word mask)
 
-typedef struct Symbol {
-  int32_t id;  // current token's int value
-  struct Symbol* prev;  // previous token
-  struct Symbol* next;  // next token
-  bool deleted; // check deleted or not?
-} Symbol;
+#define  PAIR_QUEUE_HEAP  0  // indexed MaxHeap, ties go to the smallest pair
+#define  PAIR_QUEUE_BUCKET  1  // frequency BucketQueue, ties go to the latest updated pair
 
-typedef struct WordPos {
-  size_t word_index;  // index to word list
-  Symbol* pos;  // pointer to first bigram symbol
-} WordPos;
+// bytes that split the corpus into words, shared by the loaders & the encoder
+static inline bool is_word_sep(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\0';
+}
 
 typedef struct Corpus {
-  Symbol** words; // index to a word list
+  int32_t* tokens;  // every word's symbols packed back to back, merged in place
+  size_t* offsets;  // word i starts at tokens[offsets[i]], vocab_size + 1 entries
+  uint32_t* lengths;  // current no of symbols in word i (shrinks as merges apply)
   uint64_t* word_counts;  // corresponding freq
   size_t vocab_size;  // no of unique word in train corpus
 } Corpus;
@@ -45,29 +53,68 @@ typedef struct BPEConfig {
   int32_t unk_id;   // for unknown tokens
   float character_coverage;   // 0.995 -> 99.5%
   uint64_t min_pair_freq;   // eg: 400
+  uint32_t verify_every;  // debug: recount the merged pair every N merges (0 -> off)
+  int32_t num_threads;  // threads for loading, bigram counting & large merges (<= 0 -> all hardware threads)
+  int32_t pair_queue;   // PAIR_QUEUE_HEAP (default) or PAIR_QUEUE_BUCKET
+  size_t word_budget;   // bytes the word count table may use while loading text (0 -> unbounded)
+  uint64_t min_word_freq;   // words seen fewer times are dropped before training (0 -> keep all)
+  int32_t multi_merge;  // 1 -> apply runs of top pairs with disjoint symbols in one walk (same merges)
 } BPEConfig;
 
 typedef struct Trainer {
   BPEConfig config;
   MaxHeap heap;
+  BucketQueue buckets;  // used instead of `heap` with PAIR_QUEUE_BUCKET
   Corpus corpus;
   BIMap bigram_map;
+  PairIndex pair_index;   // pair -> words containing it
+  Arena delta_arena;  // FreqChange nodes of the merge in flight, reset after every merge
   size_t next_token;    // id for next token
   size_t num_merges;
+  size_t verify_mismatches;   // incremental vs recounted freq disagreements (verify mode)
   PairKey* merge_ops;
   char** token_strs;
   uint64_t* token_freq;
+  char* checkpoint_path;  // owned copy, NULL -> no periodic checkpoints
+  uint32_t checkpoint_every;  // merges between checkpoints
+  size_t* snapshot_sizes;   // ascending vocab sizes to save on the way to the target
+  size_t num_snapshots;
+  char* snapshot_prefix;  // snapshot files are <prefix>_<size>.bin / .vocab
+  uint32_t* active_words;   // ascending ids of words that can still take part in a merge
+  size_t num_active;
+  size_t active_merges;   // num_merges when the active list was last compacted
+  size_t live_pairs;  // bigram map pairs with freq > 0, the rest only pin ids & slots
+  size_t pair_compactions;  // times the bigram map was rebuilt without its dead pairs
+  size_t grouped_merges;  // merges committed through a multi_merge group of 2+
+  size_t group_rollbacks;   // groups cut short because an earlier merge's new pair took the lead
 } Trainer;
 
+typedef struct BPEAllocStats {
+  uint64_t delta_allocs;  // FreqChange nodes & sorted views served by the delta arena
+  uint64_t delta_blocks;  // blocks actually malloc'd for them
+  uint64_t delta_resets;  // bulk releases, one per merge
+  uint64_t index_allocs;  // pair index entries
+  uint64_t index_blocks;
+} BPEAllocStats;
+
 extern "C" {
   Trainer* create_trainer(const BPEConfig* config);
   void bpe_trainer_destroy(Trainer* trainer);
   int bpe_load_corpus(Trainer* trainer, const char* input_path);
+  int bpe_build_word_cache(const char* input_path, const char* cache_path, int32_t num_threads);  // text -> word/count file
+  int bpe_load_word_cache(Trainer* trainer, const char* cache_path);  // instead of bpe_load_corpus
+  int bpe_load_model(Trainer* trainer, const char* model_path);   // merges from bpe_save, replayed onto the loaded corpus
+  int bpe_read_merges(const char* model_path, size_t min_cap, PairKey** ops, size_t* n, BIMap* ranks);  // merges file -> list & rank map
 
   void bpe_init(Trainer* trainer);
   void bpe_count_bigrams(Trainer* trainer);
   int bpe_merge_batch(Trainer* trainer, int batch_size);
   int bpe_train(Trainer* trainer);
+  void bpe_set_checkpoint(Trainer* trainer, const char* path, uint32_t every);
+  int bpe_set_snapshots(Trainer* trainer, const size_t* sizes, size_t n, const char* prefix);
+  int bpe_save_checkpoint(const Trainer* trainer, const char* path);
+  int bpe_resume(Trainer* trainer, const char* checkpoint_path);  // load a checkpoint & train on to the target
+  void bpe_alloc_stats(const Trainer* trainer, BPEAllocStats* stats);
   void bpe_save(const Trainer* trainer, const char* model_path, const char* vocab_path);
 }
 
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "bucket.h"
+
+// --- make the per pair id arrays cover `id` ---
+static void bq_reserve(BucketQueue* q, uint32_t id) {
+  if (id < q->nids) return;
+  size_t n = q->nids ? q->nids : 1024;
+  while (n <= id) n *= 2;
+  uint32_t* nx = (uint32_t*)realloc(q->next, n * sizeof(uint32_t));
+  uint32_t* pv = (uint32_t*)realloc(q->prev, n * sizeof(uint32_t));
+  uint32_t* bk = (uint32_t*)realloc(q->bucket, n * sizeof(uint32_t));
+  PairKey* ks = (PairKey*)realloc(q->keys, n * sizeof(PairKey));
+  uint8_t* qd = (uint8_t*)realloc(q->queued, n * sizeof(uint8_t));
+  if (!nx || !pv || !bk || !ks || !qd) {
+    fprintf(stderr, "[ERROR]\t Bucket queue reallocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(qd + q->nids, 0, n - q->nids);
+  q->next = nx, q->prev = pv, q->bucket = bk, q->keys = ks, q->queued = qd;
+  q->nids = n;
+}
+
+static inline void bq_unlink(BucketQueue* q, uint32_t id) {
+  uint32_t p = q->prev[id], n = q->next[id];
+  if (p != BQ_NONE) q->next[p] = n;
+  else q->head[q->bucket[id]] = n;
+  if (n != BQ_NONE) q->prev[n] = p;
+  q->queued[id] = 0;
+  q->size--;
+}
+
+/**
+ @brief Initialize the queue for counts up to `max_freq`.
+ * the dense bucket array is capped at BQ_MAX_BUCKETS, anything above goes to the overflow heap.
+*/
+void bq_init(BucketQueue* q, uint64_t max_freq) {
+  if (!q) {
+    fprintf(stderr, "[ERROR]\t Bucket queue pointer is NULL\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(q, 0, sizeof(BucketQueue));
+  q->nbuckets = max_freq + 1 < BQ_MAX_BUCKETS ? (size_t)max_freq + 1 : BQ_MAX_BUCKETS;
+  q->head = (uint32_t*)malloc(q->nbuckets * sizeof(uint32_t));
+  if (!q->head) {
+    fprintf(stderr, "[ERROR]\t Bucket queue allocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < q->nbuckets; i++) q->head[i] = BQ_NONE;
+  heap_init(&q->overflow, 64);
+}
+
+// --- insert a pair or move it to the bucket of its new frequency ---
+void bq_update(BucketQueue* q, PairKey key, uint64_t freq, uint32_t id) {
+  bq_reserve(q, id);
+  if (q->queued[id]) bq_unlink(q, id);
+  if (freq >= q->nbuckets) {
+    size_t before = q->overflow.size;
+    heap_update(&q->overflow, key, freq, id);
+    q->size += q->overflow.size - before;
+    return;
+  }
+  if (id < q->overflow.npos && q->overflow.pos[id] != HEAP_NPOS) {
+    heap_remove(&q->overflow, id);
+    q->size--;
+  }
+  uint32_t b = (uint32_t)freq;
+  q->keys[id] = key;
+  q->bucket[id] = b;
+  q->prev[id] = BQ_NONE;
+  q->next[id] = q->head[b];
+  if (q->head[b] != BQ_NONE) q->prev[q->head[b]] = id;
+  q->head[b] = id;
+  q->queued[id] = 1;
+  q->size++;
+  if (b > q->top) q->top = b;
+}
+
+// --- drop a pair from whichever structure holds it ---
+void bq_remove(BucketQueue* q, uint32_t id) {
+  if (id < q->nids && q->queued[id]) {
+    bq_unlink(q, id);
+  } else if (id < q->overflow.npos && q->overflow.pos[id] != HEAP_NPOS) {
+    heap_remove(&q->overflow, id);
+    q->size--;
+  }
+}
+
+// --- move the cursor down to the highest non-empty bucket ---
+static inline void bq_settle(BucketQueue* q) {
+  while (q->top > 0 && q->head[q->top] == BQ_NONE) q->top--;
+}
+
+// --- remove & return the most frequent pair, the overflow heap always outranks the buckets ---
+BPEHeapEntry bq_pop(BucketQueue* q) {
+  if (q->size == 0) {
+    fprintf(stderr, "[ERROR]\t Cannot pop from empty bucket queue\n");
+    exit(EXIT_FAILURE);
+  }
+  if (!heap_empty(&q->overflow)) {
+    q->size--;
+    return heap_pop(&q->overflow);
+  }
+  bq_settle(q);
+  uint32_t id = q->head[q->top];
+  BPEHeapEntry top = {q->keys[id], (uint64_t)q->top, id};
+  bq_unlink(q, id);
+  return top;
+}
+
+uint64_t bq_top_freq(BucketQueue* q) {
+  if (q->size == 0) return 0;
+  if (!heap_empty(&q->overflow)) return q->overflow.data[0].freq;
+  bq_settle(q);
+  return (uint64_t)q->top;
+}
+
+int bq_empty(const BucketQueue* q) {
+  return q->size == 0;
+}
+
+/**
+ @brief Give every queued pair a new id, keeping each bucket's list order.
+ * `remap[old]` is the new id of pair `old` (n entries, every queued pair must have
+    one) & `nids` bounds the new ids. the per id arrays are reallocated to fit, so
+    this is how the queue gives back the slots of pairs that are gone.
+ * lists keep their order, so ties still pop exactly as they would have.
+*/
+void bq_renumber(BucketQueue* q, const uint32_t* remap, size_t n, size_t nids) {
+  size_t cap = 1024;
+  while (cap < nids) cap *= 2;
+  uint32_t* nx = (uint32_t*)malloc(cap * sizeof(uint32_t));
+  uint32_t* pv = (uint32_t*)malloc(cap * sizeof(uint32_t));
+  uint32_t* bk = (uint32_t*)malloc(cap * sizeof(uint32_t));
+  PairKey* ks = (PairKey*)malloc(cap * sizeof(PairKey));
+  uint8_t* qd = (uint8_t*)calloc(cap, sizeof(uint8_t));
+  BPEHeapEntry* over = (BPEHeapEntry*)malloc((q->overflow.size ? q->overflow.size : 1) * sizeof(BPEHeapEntry));
+  if (!nx || !pv || !bk || !ks || !qd || !over) {
+    fprintf(stderr, "[ERROR]\t Bucket queue reallocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t lim = q->nids < n ? q->nids : n;
+  for (size_t o = 0; o < lim; o++) {
+    if (!q->queued[o]) continue;
+    uint32_t id = remap[o];
+    nx[id] = q->next[o] == BQ_NONE ? BQ_NONE : remap[q->next[o]];
+    pv[id] = q->prev[o] == BQ_NONE ? BQ_NONE : remap[q->prev[o]];
+    bk[id] = q->bucket[o];
+    ks[id] = q->keys[o];
+    qd[id] = 1;
+  }
+  for (size_t b = 0; b < q->nbuckets; b++) {
+    if (q->head[b] != BQ_NONE) q->head[b] = remap[q->head[b]];
+  }
+  for (size_t i = 0; i < q->overflow.size; i++) {
+    over[i] = q->overflow.data[i];
+    over[i].id = remap[over[i].id];
+  }
+  heap_build(&q->overflow, over, q->overflow.size);
+  free(over);
+  free(q->next), free(q->prev), free(q->bucket), free(q->keys), free(q->queued);
+  q->next = nx, q->prev = pv, q->bucket = bk, q->keys = ks, q->queued = qd;
+  q->nids = cap;
+}
+
+// --- Free all resources held by the queue ---
+void bq_free(BucketQueue* q) {
+  if (!q) return;
+  free(q->head);
+  free(q->next);
+  free(q->prev);
+  free(q->bucket);
+  free(q->keys);
+  free(q->queued);
+  if (q->overflow.data) heap_free(&q->overflow);
+  memset(q, 0, sizeof(BucketQueue));
+}
@@ -0,0 +1,51 @@
+/**
+ @file bucket.h
+ @brief bucket queue for BPE pair selection, alternative to the MaxHeap.
+
+ * pair counts are integers that (after the initial count) never grow past the
+    current max: a merge only lowers old pairs & creates new ones no more frequent
+    than the merged pair. so pairs are kept in per-frequency doubly linked lists &
+    the max is found by walking a cursor downwards, O(1) update & amortised O(1) pop.
+ * only frequencies below `nbuckets` get a list; the few pairs above that live in an
+    overflow MaxHeap (reusing the dense pair ids), which always outranks the buckets.
+ * ties within a frequency go to the most recently updated pair (LIFO), not to the
+    smallest key like the heap does, so the two engines can pick different merges
+    among equally frequent pairs.
+*/
+
+#ifndef __BPE_BUCKET_H__
+#define __BPE_BUCKET_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.h"
+#include "heap.h"
+
+#define BQ_MAX_BUCKETS  (1 << 20)   // dense lists for freq < 1M, the rest overflow to a heap
+#define BQ_NONE  UINT32_MAX
+
+typedef struct BucketQueue {
+  uint32_t* head;   // freq -> first pair id in that bucket
+  size_t nbuckets;
+  size_t top;   // no bucket above this one is non-empty
+  uint32_t *next, *prev;  // per pair id, bucket list links
+  uint32_t* bucket;   // per pair id, freq bucket the pair sits in
+  PairKey* keys;  // per pair id
+  uint8_t* queued;  // per pair id, 1 while in a bucket list
+  size_t nids;  // length of the per pair id arrays
+  size_t size;  // no of queued pairs (buckets + overflow)
+  MaxHeap overflow;   // pairs with freq >= nbuckets
+} BucketQueue;
+
+extern "C" {
+  void bq_init(BucketQueue* q, uint64_t max_freq);
+  void bq_update(BucketQueue* q, PairKey key, uint64_t freq, uint32_t id);  // insert or move to its new bucket
+  void bq_remove(BucketQueue* q, uint32_t id);  // no-op if the pair isn't queued
+  BPEHeapEntry bq_pop(BucketQueue* q);
+  uint64_t bq_top_freq(BucketQueue* q);   // 0 when empty
+  int bq_empty(const BucketQueue* q);
+  void bq_renumber(BucketQueue* q, const uint32_t* remap, size_t n, size_t nids);  // move pairs to new ids, ties keep their order
+  void bq_free(BucketQueue* q);
+}
+
+#endif  //!__BPE_BUCKET_H__
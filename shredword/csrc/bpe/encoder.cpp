@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "encoder.h"
+#include "bpe.h"
+#include "../inc/threads.h"
+
+#define ENCODER_CACHE_LIMIT  (1 << 24)  // keeps cache offsets within 32 bits
+
+static void* enc_grow(void* p, size_t* cap, size_t need, size_t elem, size_t first) {
+  if (need <= *cap) return p;
+  size_t c = *cap ? *cap : first;
+  while (c < need) c *= 2;
+  p = realloc(p, c * elem);
+  if (!p) {
+    fprintf(stderr, "[ERROR]\t Encoder buffer allocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  *cap = c;
+  return p;
+}
+
+// --- FNV-1a over the word bytes ---
+static inline uint64_t word_hash(const unsigned char* w, uint32_t n) {
+  uint64_t h = 1469598103934665603ULL;
+  for (uint32_t i = 0; i < n; i++) h = (h ^ w[i]) * 1099511628211ULL;
+  return h;
+}
+
+static void state_init(EncState* st, size_t cache_words) {
+  memset(st, 0, sizeof(EncState));
+  if (!cache_words) return;
+  st->cap = 16;
+  while (st->cap < cache_words * 2) st->cap <<= 1;
+  st->slots = (EncCacheSlot*)calloc(st->cap, sizeof(EncCacheSlot));
+  if (!st->slots) {
+    fprintf(stderr, "[ERROR]\t Encoder cache allocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void state_free(EncState* st) {
+  free(st->slots);
+  free(st->keys);
+  free(st->toks);
+  free(st->sym);
+  free(st->prev);
+  free(st->next);
+  free(st->cands);
+}
+
+static EncCacheSlot* cache_find(EncState* st, const unsigned char* w, uint32_t n, uint64_t h) {
+  size_t mask = st->cap - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    EncCacheSlot* s = &st->slots[i];
+    if (s->key_len == 0) return s;
+    if (s->hash == h && s->key_len == n && memcmp(st->keys + s->key_off, w, n) == 0) return s;
+  }
+}
+
+// --- remember w -> ids in `slot` (the free slot cache_find returned), the whole cache is dropped once full ---
+static void cache_put(BPEEncoder* enc, EncState* st, EncCacheSlot* slot, const unsigned char* w, uint32_t n, uint64_t h, const int32_t* ids, uint32_t k) {
+  if (st->size >= enc->cache_words) {
+    memset(st->slots, 0, st->cap * sizeof(EncCacheSlot));
+    st->size = st->keys_used = st->toks_used = 0;
+    slot = cache_find(st, w, n, h);
+  }
+  st->keys = (char*)enc_grow(st->keys, &st->keys_cap, st->keys_used + n, 1, 4096);
+  st->toks = (int32_t*)enc_grow(st->toks, &st->toks_cap, st->toks_used + k, sizeof(int32_t), 1024);
+  memcpy(st->keys + st->keys_used, w, n);
+  memcpy(st->toks + st->toks_used, ids, k * sizeof(int32_t));
+  slot->hash = h;
+  slot->key_off = (uint32_t)st->keys_used, slot->key_len = n;
+  slot->tok_off = (uint32_t)st->toks_used, slot->tok_len = k;
+  st->keys_used += n;
+  st->toks_used += k;
+  st->size++;
+}
+
+// candidates are (rank << 32 | position), so the min-heap pops the lowest rank, leftmost first
+static inline void cand_push(uint64_t* heap, size_t* n, uint64_t c) {
+  size_t i = (*n)++;
+  while (i > 0) {
+    size_t p = (i - 1) / 2;
+    if (heap[p] <= c) break;
+    heap[i] = heap[p];
+    i = p;
+  }
+  heap[i] = c;
+}
+
+static inline uint64_t cand_pop(uint64_t* heap, size_t* n) {
+  uint64_t top = heap[0], last = heap[--(*n)];
+  size_t i = 0;
+  for (;;) {
+    size_t l = 2 * i + 1;
+    if (l >= *n) break;
+    if (l + 1 < *n && heap[l + 1] < heap[l]) l++;
+    if (last <= heap[l]) break;
+    heap[i] = heap[l];
+    i = l;
+  }
+  heap[i] = last;
+  return top;
+}
+
+static inline void push_pair(const BPEEncoder* enc, uint64_t* heap, size_t* n, const int32_t* sym, int32_t i, int32_t j) {
+  PairKey pk = {sym[i], sym[j]};
+  const Info* info = bimap_find(&enc->ranks, pk);
+  if (info) cand_push(heap, n, ((uint64_t)info->id << 32) | (uint32_t)i);
+}
+
+/**
+ @brief Merge the bytes of one word into `out`, returns the no of ids.
+ * symbols form a linked list; every adjacent pair with a rank sits in a min-heap.
+   popped entries whose pair has changed since they were pushed are skipped, so each
+   merge costs two rank lookups for the new neighbours instead of a rescan of the word.
+ * a merge only creates pairs ranked after itself, so this applies merges in the same
+   order as bpe_load_model's replay & training.
+*/
+static uint32_t merge_word(const BPEEncoder* enc, EncState* st, const unsigned char* w, uint32_t n, int32_t* out) {
+  if (n > st->scratch_cap) {
+    size_t cap = st->scratch_cap ? st->scratch_cap : 64;
+    while (cap < n) cap *= 2;
+    st->sym = (int32_t*)realloc(st->sym, cap * sizeof(int32_t));
+    st->prev = (int32_t*)realloc(st->prev, cap * sizeof(int32_t));
+    st->next = (int32_t*)realloc(st->next, cap * sizeof(int32_t));
+    st->cands = (uint64_t*)realloc(st->cands, 3 * cap * sizeof(uint64_t));   // n - 1 initial pairs + 2 per merge
+    if (!st->sym || !st->prev || !st->next || !st->cands) {
+      fprintf(stderr, "[ERROR]\t Encoder scratch allocation failed\n");
+      exit(EXIT_FAILURE);
+    }
+    st->scratch_cap = cap;
+  }
+  int32_t *sym = st->sym, *prev = st->prev, *next = st->next;
+  uint64_t* heap = st->cands;
+  size_t hn = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    sym[i] = w[i];
+    prev[i] = (int32_t)i - 1;
+    next[i] = i + 1 < n ? (int32_t)i + 1 : -1;
+  }
+  for (uint32_t i = 0; i + 1 < n; i++) push_pair(enc, heap, &hn, sym, i, i + 1);
+  while (hn > 0) {
+    uint64_t c = cand_pop(heap, &hn);
+    uint32_t rank = (uint32_t)(c >> 32);
+    int32_t i = (int32_t)(c & 0xFFFFFFFF), j = next[i];
+    PairKey pk = enc->merges[rank];
+    if (sym[i] != pk.first || j < 0 || sym[j] != pk.second) continue;   // stale
+    sym[i] = INITIAL_VOCAB_SIZE + (int32_t)rank;
+    sym[j] = -1;
+    next[i] = next[j];
+    if (next[j] >= 0) prev[next[j]] = i;
+    if (prev[i] >= 0) push_pair(enc, heap, &hn, sym, prev[i], i);
+    if (next[i] >= 0) push_pair(enc, heap, &hn, sym, i, next[i]);
+  }
+  uint32_t k = 0;
+  for (int32_t i = 0; i >= 0; i = next[i]) out[k++] = sym[i];
+  return k;
+}
+
+static uint32_t encode_word(BPEEncoder* enc, EncState* st, const unsigned char* w, uint32_t n, int32_t* out) {
+  if (n == 1) {
+    out[0] = w[0];
+    return 1;
+  }
+  if (!enc->cache_words || n > ENCODER_CACHE_MAX_LEN) {
+    st->misses++;
+    return merge_word(enc, st, w, n, out);
+  }
+  uint64_t h = word_hash(w, n);
+  EncCacheSlot* slot = cache_find(st, w, n, h);
+  if (slot->key_len) {
+    st->hits++;
+    memcpy(out, st->toks + slot->tok_off, slot->tok_len * sizeof(int32_t));
+    return slot->tok_len;
+  }
+  st->misses++;
+  uint32_t k = merge_word(enc, st, w, n, out);
+  cache_put(enc, st, slot, w, n, h, out, k);
+  return k;
+}
+
+// --- encode text[begin, end) into `out`, separators become their byte ids ---
+static size_t encode_range(BPEEncoder* enc, EncState* st, const char* text, size_t begin, size_t end, int32_t* out) {
+  const unsigned char* t = (const unsigned char*)text;
+  size_t i = begin, k = 0;
+  while (i < end) {
+    if (is_word_sep(text[i])) {
+      out[k++] = t[i++];
+      continue;
+    }
+    size_t start = i;
+    while (i < end && !is_word_sep(text[i])) i++;
+    k += encode_word(enc, st, t + start, (uint32_t)(i - start), out + k);
+  }
+  return k;
+}
+
+/**
+ @brief Load a merges file written by bpe_save.
+ * num_threads <= 0 -> all hardware threads; cache_words is the per-thread word cache
+   size (0 -> no cache).
+*/
+BPEEncoder* bpe_encoder_create(const char* model_path, int32_t num_threads, size_t cache_words) {
+  if (!model_path) {
+    fprintf(stderr, "[ERROR]\t NULL model path pointer\n");
+    return NULL;
+  }
+  BPEEncoder* enc = (BPEEncoder*)calloc(1, sizeof(BPEEncoder));
+  if (!enc) {
+    fprintf(stderr, "[ERROR]\t Couldn't allocate memory for encoder\n");
+    exit(EXIT_FAILURE);
+  }
+  if (bpe_read_merges(model_path, 0, &enc->merges, &enc->num_merges, &enc->ranks) != 0) {
+    free(enc);
+    return NULL;
+  }
+  size_t T = INITIAL_VOCAB_SIZE + enc->num_merges;
+  enc->vocab_size = T;
+  enc->token_offsets = (size_t*)malloc((T + 1) * sizeof(size_t));
+  size_t* lens = (size_t*)malloc(T * sizeof(size_t));
+  if (!enc->token_offsets || !lens) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate encoder vocab\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < T; i++) lens[i] = i < INITIAL_VOCAB_SIZE ? 1 : lens[enc->merges[i - INITIAL_VOCAB_SIZE].first] + lens[enc->merges[i - INITIAL_VOCAB_SIZE].second];
+  enc->token_offsets[0] = 0;
+  for (size_t i = 0; i < T; i++) enc->token_offsets[i + 1] = enc->token_offsets[i] + lens[i];
+  free(lens);
+  enc->token_bytes = (char*)malloc(enc->token_offsets[T] ? enc->token_offsets[T] : 1);
+  if (!enc->token_bytes) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate encoder vocab\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < T; i++) {
+    char* dst = enc->token_bytes + enc->token_offsets[i];
+    if (i < INITIAL_VOCAB_SIZE) {
+      dst[0] = (char)i;
+      continue;
+    }
+    PairKey pk = enc->merges[i - INITIAL_VOCAB_SIZE];
+    size_t a = enc->token_offsets[pk.first + 1] - enc->token_offsets[pk.first];
+    memcpy(dst, enc->token_bytes + enc->token_offsets[pk.first], a);
+    memcpy(dst + a, enc->token_bytes + enc->token_offsets[pk.second], enc->token_offsets[pk.second + 1] - enc->token_offsets[pk.second]);
+  }
+  enc->cache_words = cache_words > ENCODER_CACHE_LIMIT ? ENCODER_CACHE_LIMIT : cache_words;
+  enc->num_threads = resolve_threads(num_threads);
+  enc->states = (EncState*)malloc(enc->num_threads * sizeof(EncState));
+  if (!enc->states) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate encoder states\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int t = 0; t < enc->num_threads; t++) state_init(&enc->states[t], enc->cache_words);
+  printf("[INFO]\t Loaded encoder with %zu merges (%zu tokens) from %s\n", enc->num_merges, T, model_path);
+  return enc;
+}
+
+void bpe_encoder_destroy(BPEEncoder* enc) {
+  if (!enc) return;
+  for (int t = 0; t < enc->num_threads; t++) state_free(&enc->states[t]);
+  free(enc->states);
+  bimap_free(&enc->ranks);
+  free(enc->merges);
+  free(enc->token_bytes);
+  free(enc->token_offsets);
+  free(enc);
+}
+
+/**
+ @brief Encode `len` bytes of text into `out` (room for `len` ids), returns the no of ids.
+ * large texts are cut at separators into one chunk per thread; every chunk is encoded
+   in place at its own byte offset & the pieces are then moved together in order.
+*/
+size_t bpe_encode(BPEEncoder* enc, const char* text, size_t len, int32_t* out) {
+  if (!enc || (!text && len) || (!out && len)) {
+    fprintf(stderr, "[ERROR]\t NULL encoder, text or output pointers\n");
+    return 0;
+  }
+  int threads = threads_for(len, enc->num_threads, ENCODE_MIN_BYTES);
+  if (threads <= 1) return encode_range(enc, &enc->states[0], text, 0, len, out);
+  size_t* cuts = (size_t*)malloc((threads + 1) * sizeof(size_t));
+  size_t* counts = (size_t*)malloc(threads * sizeof(size_t));
+  if (!cuts || !counts) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate encoder chunks\n");
+    exit(EXIT_FAILURE);
+  }
+  cuts[0] = 0, cuts[threads] = len;
+  for (int t = 1; t < threads; t++) {
+    size_t c = len / threads * t;
+    if (c < cuts[t - 1]) c = cuts[t - 1];
+    while (c < len && !is_word_sep(text[c])) c++;
+    cuts[t] = c;
+  }
+  parallel_for((size_t)threads, threads, [&](int tid, size_t begin, size_t end) {
+    for (size_t t = begin; t < end; t++) counts[t] = encode_range(enc, &enc->states[tid], text, cuts[t], cuts[t + 1], out + cuts[t]);
+  });
+  size_t k = 0;
+  for (int t = 0; t < threads; t++) {
+    memmove(out + k, out + cuts[t], counts[t] * sizeof(int32_t));
+    k += counts[t];
+  }
+  free(cuts);
+  free(counts);
+  return k;
+}
+
+/**
+ @brief Encode `n` texts, the texts are spread over the encoder's threads.
+ * `out` needs room for sum(lens) ids & `offsets` for n + 1 entries: text i ends up
+   as out[offsets[i], offsets[i + 1]).
+*/
+int bpe_encode_batch(BPEEncoder* enc, const char* const* texts, const size_t* lens, size_t n, int32_t* out, size_t* offsets) {
+  if (!enc || !offsets || (n && (!texts || !lens || !out))) {
+    fprintf(stderr, "[ERROR]\t NULL encoder, texts or output pointers\n");
+    return -1;
+  }
+  size_t* counts = (size_t*)malloc((n ? n : 1) * sizeof(size_t));
+  if (!counts) {
+    fprintf(stderr, "[ERROR]\t Failed to allocate batch counts\n");
+    exit(EXIT_FAILURE);
+  }
+  offsets[0] = 0;
+  for (size_t i = 0; i < n; i++) offsets[i + 1] = offsets[i] + lens[i];
+  int threads = threads_for(n, enc->num_threads, ENCODE_MIN_TEXTS);
+  parallel_for(n, threads, [&](int tid, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) counts[i] = encode_range(enc, &enc->states[tid], texts[i], 0, lens[i], out + offsets[i]);
+  });
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    memmove(out + k, out + offsets[i], counts[i] * sizeof(int32_t));
+    offsets[i] = k;
+    k += counts[i];
+  }
+  offsets[n] = k;
+  free(counts);
+  return 0;
+}
+
+// --- write the bytes of `ids` into out (at most `cap`), returns the full length or -1 on an unknown id ---
+int64_t bpe_decode(const BPEEncoder* enc, const int32_t* ids, size_t n, char* out, size_t cap) {
+  if (!enc || (!ids && n)) {
+    fprintf(stderr, "[ERROR]\t NULL encoder or ids pointers\n");
+    return -1;
+  }
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (ids[i] < 0 || (size_t)ids[i] >= enc->vocab_size) {
+      fprintf(stderr, "[ERROR]\t Invalid token id %d at position %zu\n", ids[i], i);
+      return -1;
+    }
+    size_t b = enc->token_offsets[ids[i]], len = enc->token_offsets[ids[i] + 1] - b;
+    if (out && k < cap) memcpy(out + k, enc->token_bytes + b, k + len <= cap ? len : cap - k);
+    k += len;
+  }
+  return (int64_t)k;
+}
+
+void bpe_encoder_stats(const BPEEncoder* enc, BPEEncoderStats* stats) {
+  memset(stats, 0, sizeof(BPEEncoderStats));
+  if (!enc) return;
+  for (int t = 0; t < enc->num_threads; t++) {
+    stats->cache_hits += enc->states[t].hits;
+    stats->cache_misses += enc->states[t].misses;
+  }
+}
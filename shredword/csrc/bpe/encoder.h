@@ -0,0 +1,78 @@
+/**
+ @file encoder.h
+ @brief native BPE encoder over the merges written by bpe_save.
+
+ * the merges are loaded into a rank table ((a, b) -> merge index); a word is encoded
+    by a priority loop that always applies its lowest ranked pair, the same order
+    bpe_load_model replays merges in, so a trained word encodes to its trained tokens.
+ * text is split into words on the trainer's separators (is_word_sep); separators are
+    emitted as their byte ids so decoding gives back the exact input. a text of n bytes
+    therefore never encodes to more than n ids.
+ * recently seen words are kept in a per-thread word -> ids cache, so repeated words
+    skip the merge loop entirely.
+ * one encoder may not be used from several threads at once, batch & large inputs
+    are spread over `num_threads` internally.
+ * compile it along with bpe.cpp:
+    *- g++ -shared -fPIC -o libbpe.so bpe/encoder.cpp bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp bpe/index.cpp bpe/bucket.cpp -pthread
+*/
+
+#ifndef __BPE_ENCODER_H__
+#define __BPE_ENCODER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.h"
+
+#define  ENCODER_CACHE_WORDS  (1 << 16)  // default per-thread cache size (words)
+#define  ENCODER_CACHE_MAX_LEN  64  // longer words are encoded every time
+#define  ENCODE_MIN_BYTES  (1 << 20)  // min bytes per thread before one text is split
+#define  ENCODE_MIN_TEXTS  64  // min texts per thread in a batch
+
+typedef struct EncCacheSlot {
+  uint64_t hash;
+  uint32_t key_off, key_len;  // word bytes in `keys`, key_len 0 -> free slot
+  uint32_t tok_off, tok_len;  // ids in `toks`
+} EncCacheSlot;
+
+typedef struct EncState {
+  EncCacheSlot* slots;  // open addressing, cap is a power of two & 2x the word limit
+  size_t cap, size;
+  char* keys;
+  size_t keys_used, keys_cap;
+  int32_t* toks;
+  size_t toks_used, toks_cap;
+  int32_t* sym;   // merge loop scratch: symbols, links & candidate heap of one word
+  int32_t* prev;
+  int32_t* next;
+  uint64_t* cands;
+  size_t scratch_cap;
+  uint64_t hits, misses;
+} EncState;
+
+typedef struct BPEEncoder {
+  BIMap ranks;  // merged pair -> merge index (Info.id)
+  PairKey* merges;  // merge index -> pair, new id is 256 + index
+  size_t num_merges;
+  size_t vocab_size;  // 256 + num_merges
+  char* token_bytes;  // every token's bytes back to back
+  size_t* token_offsets;  // token i is token_bytes[token_offsets[i], token_offsets[i + 1])
+  size_t cache_words;   // per-thread cache limit, 0 -> no cache
+  int32_t num_threads;
+  EncState* states;   // one per thread
+} BPEEncoder;
+
+typedef struct BPEEncoderStats {
+  uint64_t cache_hits;  // words served from the cache
+  uint64_t cache_misses;  // words run through the merge loop
+} BPEEncoderStats;
+
+extern "C" {
+  BPEEncoder* bpe_encoder_create(const char* model_path, int32_t num_threads, size_t cache_words);  // NULL on a bad model
+  void bpe_encoder_destroy(BPEEncoder* enc);
+  size_t bpe_encode(BPEEncoder* enc, const char* text, size_t len, int32_t* out);   // out holds >= len ids, returns no of ids
+  int bpe_encode_batch(BPEEncoder* enc, const char* const* texts, const size_t* lens, size_t n, int32_t* out, size_t* offsets);
+  int64_t bpe_decode(const BPEEncoder* enc, const int32_t* ids, size_t n, char* out, size_t cap);   // bytes needed, -1 on a bad id
+  void bpe_encoder_stats(const BPEEncoder* enc, BPEEncoderStats* stats);
+}
+
+#endif  //!__BPE_ENCODER_H__
@@ -4,52 +4,117 @@
 #include <stdio.h>
 #include "hash.h"
 
-static uint32_t hash_pair(PairKey key) {
-  // using FNV-1a hash for better distribution
-  uint32_t hash = 2166136261u;
-  uint8_t* bytes = (uint8_t*)&key;
-  for (size_t i = 0; i < sizeof(PairKey); i++) {
-    hash ^= bytes[i];
-    hash *= 16777619u;
+// 64-bit string hash, consumes 8 bytes per step instead of one
+static inline uint64_t str_hash(const char* s, size_t len) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ (len * 0xff51afd7ed558ccdULL);
+  for (; len >= 8; s += 8, len -= 8) {
+    uint64_t w;
+    memcpy(&w, s, 8);
+    h = (h ^ pair_mix(w)) * 0x9e3779b97f4a7c15ULL;
   }
-  return hash;
+  if (len) {
+    uint64_t w = 0;
+    memcpy(&w, s, len);
+    h = (h ^ pair_mix(w)) * 0x9e3779b97f4a7c15ULL;
+  }
+  return pair_mix(h);
+}
+
+// --- copy `len` bytes + NUL into the arena, opening a new block when the current one is full ---
+static const char* strmap_intern(StrMap* map, const char* key, size_t len) {
+  StrBlock* b = map->arena;
+  if (!b || b->cap - b->used < len + 1) {
+    size_t cap = len + 1 > STRMAP_BLOCK_SIZE ? len + 1 : STRMAP_BLOCK_SIZE;
+    b = (StrBlock*)malloc(sizeof(StrBlock) + cap);
+    if (!b) {
+      fprintf(stderr, "[ERROR]\t String arena allocation failed\n");
+      exit(EXIT_FAILURE);
+    }
+    b->used = 0, b->cap = cap;
+    b->next = map->arena;
+    map->arena = b;
+  }
+  char* dst = (char*)(b + 1) + b->used;
+  memcpy(dst, key, len);
+  dst[len] = '\0';
+  b->used += len + 1;
+  return dst;
+}
+
+// stored keys are NUL-terminated, `key` is `len` bytes & may point into a larger buffer
+static inline bool strmap_match(const char* stored, const char* key, size_t len) {
+  return strncmp(stored, key, len) == 0 && stored[len] == '\0';
 }
 
-// --- Initialize a string map with given bucket count (power of two) ---
+static inline StrEntry* strmap_probe(StrEntry* slots, size_t cap, const char* key, size_t len, uint64_t h) {
+  size_t mask = cap - 1, i = (size_t)h & mask;
+  while (slots[i].key && (slots[i].hash != h || !strmap_match(slots[i].key, key, len))) i = (i + 1) & mask;
+  return &slots[i];
+}
+
+// --- double the slot array, cached hashes mean no key is rehashed ---
+static void strmap_grow(StrMap* map) {
+  size_t new_cap = map->cap * 2, mask = new_cap - 1;
+  StrEntry* ns = (StrEntry*)calloc(new_cap, sizeof(StrEntry));
+  if (!ns) {
+    fprintf(stderr, "[ERROR]\t String map resize failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < map->cap; i++) {
+    if (!map->slots[i].key) continue;
+    size_t j = (size_t)map->slots[i].hash & mask;
+    while (ns[j].key) j = (j + 1) & mask;
+    ns[j] = map->slots[i];
+  }
+  free(map->slots);
+  map->slots = ns;
+  map->cap = new_cap;
+}
+
+// --- Initialize a string map with given initial slot count (rounded up to a power of two) ---
 void strmap_init(StrMap* map, size_t nbuckets) {
   if (!map) {
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  map->nbuckets = nbuckets;
-  map->buckets = (StrEntry**)calloc(nbuckets, sizeof(StrEntry*));
+  size_t cap = 16;
+  while (cap < nbuckets) cap <<= 1;
+  map->cap = cap;
+  map->size = 0;
+  map->arena = NULL;
+  map->slots = (StrEntry*)calloc(cap, sizeof(StrEntry));
 }
 
-// --- Increment the count for key (creates if missing) ---
-void strmap_increment(StrMap* map, const char* key) {
+// --- Add `delta` to the count for the `len` byte key (creates if missing) ---
+void strmap_add_n(StrMap* map, const char* key, size_t len, uint64_t delta) {
   if (!map) {
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  // djb2 hash
-  size_t h = 5381;
-  for (const unsigned char* s = (const unsigned char*)key; *s; s++) {
-    h = ((h << 5) + h) + *s;
-  }
-  size_t idx = h & (map->nbuckets - 1);
-  StrEntry** p = &map->buckets[idx];
-  while (*p) {
-    if (strcmp((*p)->key, key) == 0) {
-      (*p)->value++;
-      return;
-    }
-    p = &(*p)->next;
+  uint64_t h = str_hash(key, len);
+  StrEntry* e = strmap_probe(map->slots, map->cap, key, len, h);
+  if (e->key) {
+    e->value += delta;
+    return;
   }
-  StrEntry* e = (StrEntry*)malloc(sizeof(StrEntry));
-  e->key = strdup(key);
-  e->value = 1;
-  e->next = NULL;
-  *p = e;
+  if ((map->size + 1) * 10 > map->cap * 7) {
+    strmap_grow(map);
+    e = strmap_probe(map->slots, map->cap, key, len, h);
+  }
+  e->key = strmap_intern(map, key, len);
+  e->hash = h;
+  e->value = delta;
+  map->size++;
+}
+
+// --- Add `delta` to the count for key (creates if missing) ---
+void strmap_add(StrMap* map, const char* key, uint64_t delta) {
+  strmap_add_n(map, key, strlen(key), delta);
+}
+
+// --- Increment the count for key (creates if missing) ---
+void strmap_increment(StrMap* map, const char* key) {
+  strmap_add(map, key, 1);
 }
 
 /**
@@ -63,12 +128,48 @@ void strmap_iter(StrMap* map, void(*func)(const char*, uint64_t, void*), void* u
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  
-  for (size_t i = 0; i < map->nbuckets; i++) {
-    for (StrEntry* e = map->buckets[i]; e; e = e->next) {
-      func(e->key, e->value, user);
-    }
+  for (size_t i = 0; i < map->cap; i++) {
+    if (map->slots[i].key) func(map->slots[i].key, map->slots[i].value, user);
+  }
+}
+
+// --- bytes held by the map: slot array plus every key block ---
+size_t strmap_bytes(const StrMap* map) {
+  size_t bytes = map->cap * sizeof(StrEntry);
+  for (const StrBlock* b = map->arena; b; b = b->next) bytes += sizeof(StrBlock) + b->cap;
+  return bytes;
+}
+
+/**
+ @brief Drop every key whose value is below `min_value`, returns the no of keys dropped.
+ * survivors are copied into fresh slots & key blocks sized for them, so the memory of
+   the dropped keys is actually given back (the old arena is freed as a whole).
+*/
+size_t strmap_prune(StrMap* map, uint64_t min_value) {
+  if (!map) {
+    fprintf(stderr, "Pointer to Map not found!\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < map->cap; i++) kept += map->slots[i].key && map->slots[i].value >= min_value;
+  if (kept == map->size) return 0;
+  StrMap out;
+  strmap_init(&out, kept * 10 / 7 + 1);
+  size_t mask = out.cap - 1;
+  for (size_t i = 0; i < map->cap; i++) {
+    const StrEntry* e = &map->slots[i];
+    if (!e->key || e->value < min_value) continue;
+    size_t j = (size_t)e->hash & mask;
+    while (out.slots[j].key) j = (j + 1) & mask;
+    out.slots[j].key = strmap_intern(&out, e->key, strlen(e->key));
+    out.slots[j].hash = e->hash;
+    out.slots[j].value = e->value;
   }
+  out.size = kept;
+  size_t dropped = map->size - kept;
+  strmap_free(map);
+  *map = out;
+  return dropped;
 }
 
 // --- Free all resources held by the map ---
@@ -77,83 +178,108 @@ void strmap_free(StrMap *map) {
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  for (size_t i = 0; i < map->nbuckets; i++) {
-    StrEntry* e = map->buckets[i];
-    while (e) {
-      StrEntry *n = e->next;
-      free(e->key);
-      free(e);
-      e = n;
-    }
+  StrBlock* b = map->arena;
+  while (b) {
+    StrBlock* n = b->next;
+    free(b);
+    b = n;
+  }
+  free(map->slots);
+  map->slots = NULL;
+  map->arena = NULL;
+  map->cap = map->size = 0;
+}
+
+static BIEntry* bimap_alloc(size_t cap) {
+  BIEntry* slots = (BIEntry*)malloc(cap * sizeof(BIEntry));
+  if (!slots) {
+    fprintf(stderr, "[ERROR]\t Bigram map allocation failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < cap; i++) {
+    slots[i].key = BIMAP_EMPTY;
+    slots[i].info.freq = 0;
+    slots[i].info.id = 0;
+  }
+  return slots;
+}
+
+// --- linear probe for `key`: its slot if present, else the free slot it would go into ---
+static inline BIEntry* bimap_probe(const BIMap* map, uint64_t key) {
+  size_t mask = map->cap - 1, i = (size_t)pair_mix(key) & mask;
+  while (map->slots[i].key != key && map->slots[i].key != BIMAP_EMPTY) i = (i + 1) & mask;
+  return &map->slots[i];
+}
+
+// --- double the table & re-insert every occupied slot ---
+static void bimap_grow(BIMap* map) {
+  BIMap old = *map;
+  map->cap = old.cap * 2;
+  map->slots = bimap_alloc(map->cap);
+  for (size_t i = 0; i < old.cap; i++) {
+    if (old.slots[i].key != BIMAP_EMPTY) *bimap_probe(map, old.slots[i].key) = old.slots[i];
   }
-  free(map->buckets);
-  map->buckets = NULL;
+  free(old.slots);
 }
 
-// --- Initialize bigram info map. ---
+// --- Initialize bigram info map, `nbuckets` is the initial no of slots (power of two) ---
 void bimap_init(BIMap* map, size_t nbuckets) {
   if (!map) {
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  map->nbuckets = nbuckets;
-  map->buckets = (BIEntry**)calloc(nbuckets, sizeof(BIEntry*));
+  size_t cap = 16;
+  while (cap < nbuckets) cap <<= 1;
+  map->cap = cap;
+  map->size = 0;
+  map->slots = bimap_alloc(cap);
 }
 
 // --- Retrieve or create an Info* for a given bigram key ---
 Info* bimap_get(BIMap* map, PairKey key) {
-  if (!map) {
+  if (!map || !map->slots) {
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  uint32_t h = hash_pair(key); 
-  size_t idx = h & (map->nbuckets - 1);
-
-  // walk chain looking for existing entry
-  BIEntry **bucket = &map->buckets[idx];
-  while (*bucket) {
-    if ((*bucket)->key.first  == key.first &&
-        (*bucket)->key.second == key.second) {
-      return &(*bucket)->info;
-    }
-    bucket = &(*bucket)->next;
+  uint64_t packed = pair_pack(key);
+  BIEntry* e = bimap_probe(map, packed);
+  if (e->key == packed) return &e->info;
+  if ((map->size + 1) * 10 > map->cap * 7) {
+    bimap_grow(map);
+    e = bimap_probe(map, packed);
   }
-
-  // not found -> allocate and link new entry
-  BIEntry *entry = (BIEntry*)calloc(1, sizeof(BIEntry));  // zeros all fields
-  entry->key.first = key.first;
-  entry->key.second = key.second;
-  entry->next = NULL;
-
-  *bucket = entry;
-  return &entry->info;
+  e->key = packed;
+  e->info.id = (uint32_t)map->size++;
+  return &e->info;
 }
 
-// --- Return the current version for a key (0 if missing) ---
-uint32_t bimap_version(const BIMap* map, PairKey key) {
+// --- Look up a key without inserting it ---
+Info* bimap_find(const BIMap* map, PairKey key) {
   if (!map) {
     fprintf(stderr, "Pointer to Map not found!\n");
     exit(EXIT_FAILURE);
   }
-  uint32_t h = hash_pair(key); 
-  size_t idx = h & (map->nbuckets - 1);
-  for (BIEntry *e = map->buckets[idx]; e; e = e->next) {
-    if (e->key.first == key.first && e->key.second == key.second)
-      return e->info.version;
+  if (!map->slots) return NULL;
+  uint64_t packed = pair_pack(key);
+  BIEntry* e = bimap_probe(map, packed);
+  return e->key == packed ? &e->info : NULL;
+}
+
+// --- Add every pair count of `src` into `dst` (reduce step of parallel counting) ---
+void bimap_merge(BIMap* dst, const BIMap* src) {
+  if (!dst || !src) {
+    fprintf(stderr, "Pointer to Map not found!\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < src->cap; i++) {
+    const BIEntry* e = &src->slots[i];
+    if (e->key != BIMAP_EMPTY) bimap_get(dst, pair_unpack(e->key))->freq += e->info.freq;
   }
-  return 0;
 }
 
 // --- Free all resources held by the bigram map. ---
 void bimap_free(BIMap *map) {
-  for (size_t i = 0; i < map->nbuckets; i++) {
-    BIEntry *e = map->buckets[i];
-    while (e) {
-      BIEntry *n = e->next;
-      free(e);
-      e = n;
-    }
-  }
-  free(map->buckets);
-  map->buckets = NULL;
-}
\ No newline at end of file
+  free(map->slots);
+  map->slots = NULL;
+  map->cap = map->size = 0;
+}
@@ -2,8 +2,11 @@
  @file hash.h
  @brief hasmap implementation for particularly training BPE merges
 
- * string -> int value hashmap, maintaining version info, etc.
- * separate hashing for Bigram related task.
+ * string -> int value hashmap: open addressing over {key, hash, value} slots,
+    keys copied into a bump arena (one malloc per block, not per word).
+ * separate hashing for Bigram related task: an open-addressing table keyed by the
+    packed 64-bit pair with inline Info, grown once it gets 70% full.
+   `Info*` returned by bimap_get stays valid only until the next insert.
 */
 
 #ifndef __HASH_H__
@@ -13,15 +16,24 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define STRMAP_BLOCK_SIZE  (1 << 20)  // arena block for key bytes
+
 typedef struct StrEntry {
-  char* key;  // string or character
+  const char* key;  // string or character, lives in the map's arena (NULL -> free slot)
+  uint64_t hash;    // cached so lookups & growth skip most strcmp/rehash work
   uint64_t value;   // int64 value of its
-  struct StrEntry* next;    // linked to the next pair
 } StrEntry;
 
+typedef struct StrBlock {
+  struct StrBlock* next;
+  size_t used, cap;   // bytes handed out / available after the header
+} StrBlock;
+
 typedef struct StrMap {
-  StrEntry** buckets;
-  size_t nbuckets;
+  StrEntry* slots;
+  size_t cap;   // always a power of two
+  size_t size;  // no of distinct keys
+  StrBlock* arena;  // newest block first
 } StrMap;
 
 typedef struct PairKey {
@@ -30,31 +42,55 @@ typedef struct PairKey {
 
 typedef struct Info {
   uint64_t freq;   // frequency of a particular pair
-  uint32_t version;   // version for lazy validation
+  uint32_t id;   // dense pair id (insertion order), indexes the heap's position table
 } Info;
 
+#define BIMAP_EMPTY  UINT64_MAX   // packed (-1,-1): never a countable pair
+
 typedef struct BIEntry {
-  PairKey key;
+  uint64_t key;   // packed pair, BIMAP_EMPTY for a free slot
   Info info;
-  struct BIEntry *next;
 } BIEntry;
 
 typedef struct {
-  BIEntry **buckets;
-  size_t nbuckets;
+  BIEntry *slots;
+  size_t cap;   // always a power of two
+  size_t size;  // no of occupied slots
 } BIMap;
 
+static inline uint64_t pair_pack(PairKey key) {
+  return ((uint64_t)(uint32_t)key.first << 32) | (uint32_t)key.second;
+}
+
+static inline PairKey pair_unpack(uint64_t packed) {
+  PairKey key = {(int32_t)(packed >> 32), (int32_t)(packed & 0xFFFFFFFF)};
+  return key;
+}
+
+// murmur3 finalizer, spreads the packed pair over all bits
+static inline uint64_t pair_mix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return k;
+}
+
 extern "C" {
   // StrMap related functions ----
   void strmap_init(StrMap* map, size_t nbuckets);
   void strmap_increment(StrMap* map, const char* key);
+  void strmap_add(StrMap* map, const char* key, uint64_t delta);
+  void strmap_add_n(StrMap* map, const char* key, size_t len, uint64_t delta);  // key needn't be NUL-terminated
   void strmap_iter(StrMap* map, void(*func)(const char*, uint64_t, void*), void* user);
+  size_t strmap_bytes(const StrMap* map);
+  size_t strmap_prune(StrMap* map, uint64_t min_value);   // drops keys below min_value, returns how many
   void strmap_free(StrMap* map);
 
   // BiGram Hash related functions ----
   void bimap_init(BIMap *m, size_t nbuckets);
   Info* bimap_get(BIMap *m, PairKey key);
-  uint32_t bimap_version(const BIMap* map, PairKey key);
+  Info* bimap_find(const BIMap* map, PairKey key);   // NULL if the pair was never counted
+  void bimap_merge(BIMap* dst, const BIMap* src);
   void bimap_free(BIMap *map);
 }
 
@@ -7,15 +7,68 @@
 #include "hash.h"
 
 /**
-  @brief Swap two heap entries in-place.
-  * @param x  Pointer to the first entry.
-  * @param y  Pointer to the second entry.
+  @brief Place `e` at slot `i` & record its position.
+  * @param h  Pointer to the heap.
+  * @param i  Destination index into h->data.
+  * @param e  Entry to store.
  */
-static void he_swap(BPEHeapEntry* x, BPEHeapEntry* y) {
-  assert(x && y);
-  BPEHeapEntry tmp = *x;
-  *x = *y;
-  *y = tmp;
+static inline void he_set(MaxHeap* h, size_t i, BPEHeapEntry e) {
+  h->data[i] = e;
+  h->pos[e.id] = (uint32_t)i;
+}
+
+/**
+  @brief Heap order: higher freq first, ties go to the smaller (first, second) key.
+  * a strict total order keeps the merge sequence independent of hash-table
+    iteration order, so serial & threaded counting produce the same model.
+ */
+static inline bool he_gt(const BPEHeapEntry* x, const BPEHeapEntry* y) {
+  if (x->freq != y->freq) return x->freq > y->freq;
+  if (x->key.first != y->key.first) return x->key.first < y->key.first;
+  return x->key.second < y->key.second;
+}
+
+// --- move the entry at `idx` up while it beats its parent ---
+static void sift_up(MaxHeap* h, size_t idx) {
+  BPEHeapEntry e = h->data[idx];
+  while (idx > 0) {
+    size_t p = (idx - 1) >> 1;
+    if (!he_gt(&e, &h->data[p])) break;
+    he_set(h, idx, h->data[p]);
+    idx = p;
+  }
+  he_set(h, idx, e);
+}
+
+// --- move the entry at `idx` down while a child beats it ---
+static void sift_down(MaxHeap* h, size_t idx) {
+  BPEHeapEntry e = h->data[idx];
+  while (true) {
+    size_t left = (idx << 1) + 1, right = left + 1, best = left;
+    if (left >= h->size) break;
+    if (right < h->size && he_gt(&h->data[right], &h->data[left]))
+      best = right;
+    if (!he_gt(&h->data[best], &e))
+      break;
+    he_set(h, idx, h->data[best]);
+    idx = best;
+  }
+  he_set(h, idx, e);
+}
+
+// --- make pos[] cover `id`, new slots start out as not queued ---
+static void pos_reserve(MaxHeap* h, uint32_t id) {
+  if (id < h->npos) return;
+  size_t n = h->npos ? h->npos : 1024;
+  while (n <= id) n *= 2;
+  uint32_t* np = (uint32_t*)realloc(h->pos, sizeof(uint32_t) * n);
+  if (!np) {
+    fprintf(stderr, "Memory reallocation failed!\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = h->npos; i < n; i++) np[i] = HEAP_NPOS;
+  h->pos = np;
+  h->npos = n;
 }
 
 /**
@@ -40,21 +93,32 @@ void heap_init(MaxHeap* h, size_t capacity) {
   }
   h->size = 0;
   h->cap = capacity;
+  h->pos = NULL;
+  h->npos = 0;
 }
 
 /**
-  @brief Push a key/frequency pair onto the heap.
-          Grows the underlying array if needed.
+  @brief Insert a pair or change its frequency in place.
+          Grows the underlying arrays if needed.
   @param h Pointer to the heap.
-  @param key Merged key that needs to be updated.
+  @param key Bigram the entry stands for.
   @param freq Integer frequency used for ordering (max‑heap).
-  @param freq Version for lazy invalidation.
+  @param id Dense pair id (Info.id), identifies the entry.
  */
-void heap_push(MaxHeap* h, PairKey key, uint64_t freq, uint32_t version) {
+void heap_update(MaxHeap* h, PairKey key, uint64_t freq, uint32_t id) {
   if (h == NULL) {
     fprintf(stderr, "Error: Heap pointer is NULL.\n");
     exit(EXIT_FAILURE);
   }
+  pos_reserve(h, id);
+  size_t idx = h->pos[id];
+  if (idx != HEAP_NPOS) {
+    uint64_t old = h->data[idx].freq;
+    h->data[idx].freq = freq;
+    if (freq > old) sift_up(h, idx);
+    else sift_down(h, idx);
+    return;
+  }
   // grow if needed
   if (h->size == h->cap) {
     size_t new_cap = h->cap * 2;
@@ -65,23 +129,71 @@ void heap_push(MaxHeap* h, PairKey key, uint64_t freq, uint32_t version) {
     }
     h->data = new_data;
     h->cap = new_cap;
-  }  
+  }
   // insert at end and sift up
-  size_t idx = h->size++;
-  h->data[idx].key = key;
-  h->data[idx].freq = freq;
-  h->data[idx].version = version;
-  while (idx > 0) {
-    size_t p = (idx - 1) >> 1;
-    if (h->data[p].freq >= h->data[idx].freq) break;
-    he_swap(&h->data[p], &h->data[idx]);
-    idx = p;
+  idx = h->size++;
+  BPEHeapEntry e = {key, freq, id};
+  he_set(h, idx, e);
+  sift_up(h, idx);
+}
+
+/**
+  @brief Replace the heap's contents with `n` entries in linear time (Floyd's heapify).
+  * the entry array is resized to fit them (never below MIN_HEAP_SIZE) & pos[] is
+    rebuilt for their ids, so a heap that has shrunk gives its memory back.
+  * pops come out in the same order as after n heap_update calls: the order is total.
+  @param h Pointer to the heap.
+  @param entries Entries with distinct ids.
+  @param n No of entries.
+ */
+void heap_build(MaxHeap* h, const BPEHeapEntry* entries, size_t n) {
+  if (h == NULL) {
+    fprintf(stderr, "Error: Heap pointer is NULL.\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t cap = n > MIN_HEAP_SIZE ? n : MIN_HEAP_SIZE;
+  if (cap != h->cap) {
+    BPEHeapEntry* nd = (BPEHeapEntry*)realloc(h->data, sizeof(BPEHeapEntry) * cap);
+    if (!nd) {
+      fprintf(stderr, "Memory reallocation failed!\n");
+      exit(EXIT_FAILURE);
+    }
+    h->data = nd;
+    h->cap = cap;
   }
+  free(h->pos);
+  h->pos = NULL;
+  h->npos = 0;
+  uint32_t max_id = 0;
+  for (size_t i = 0; i < n; i++) if (entries[i].id > max_id) max_id = entries[i].id;
+  pos_reserve(h, max_id);
+  h->size = n;
+  for (size_t i = 0; i < n; i++) he_set(h, i, entries[i]);
+  for (size_t i = n / 2; i-- > 0;) sift_down(h, i);
+}
+
+/**
+  @brief Drop a pair from the heap (e.g. its freq fell below the merge threshold).
+  @param h Pointer to the heap.
+  @param id Dense pair id, ignored if the pair isn't queued.
+ */
+void heap_remove(MaxHeap* h, uint32_t id) {
+  if (h == NULL) {
+    fprintf(stderr, "Error: Heap pointer is NULL.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (id >= h->npos || h->pos[id] == HEAP_NPOS) return;
+  size_t idx = h->pos[id];
+  h->pos[id] = HEAP_NPOS;
+  BPEHeapEntry last = h->data[--h->size];
+  if (idx == h->size) return;
+  he_set(h, idx, last);
+  sift_up(h, idx);
+  sift_down(h, h->pos[last.id]);
 }
 
 /**
   @brief Pop the top (highest-frequency) entry from the heap.
-          The returned BPEHeapEntry.key must be freed by the caller.
   @param h Pointer to the heap.
   @return The popped BPEHeapEntry.
  */
@@ -95,21 +207,7 @@ BPEHeapEntry heap_pop(MaxHeap* h) {
     exit(EXIT_FAILURE);
   }
   BPEHeapEntry top = h->data[0];
-  h->data[0] = h->data[--h->size];
-
-  size_t idx = 0;
-  while (true) {
-    size_t left = (idx << 1) + 1, right = left + 1, best = idx;
-    if (left < h->size && h->data[left].freq > h->data[best].freq)
-      best = left;
-    if (right < h->size && h->data[right].freq > h->data[best].freq)
-      best = right;
-    if (best == idx)
-      break;
-    he_swap(&h->data[idx], &h->data[best]);
-    idx = best;
-  }
-
+  heap_remove(h, top.id);
   return top;
 }
 
@@ -136,6 +234,8 @@ void heap_free(MaxHeap* h) {
     exit(EXIT_FAILURE);
   }
   free(h->data);
+  free(h->pos);
   h->data = NULL;
-  h->size = h->cap = 0;
-}
\ No newline at end of file
+  h->pos = NULL;
+  h->size = h->cap = h->npos = 0;
+}
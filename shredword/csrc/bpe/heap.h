@@ -1,10 +1,12 @@
 /**
  @file heap.h
- @brief A simple max‑heap implementation over string keys and integer frequencies.
+ @brief An indexed max‑heap over bigram keys and integer frequencies.
 
  * This heap is used in the BPE merge process to always pop the
- * highest‑frequency symbol pair. Keys are C‑strings (heap owns them),
- * and must be freed after use. 
+ * highest‑frequency symbol pair. Every pair is identified by its dense
+ * id (Info.id) & `pos[id]` tracks where it sits, so a pair is queued at
+ * most once & its frequency is changed in place (increase/decrease-key)
+ * instead of pushing a new entry. The heap never holds stale entries.
 */
 
 #ifndef __BPE_HEAP_H__
@@ -14,25 +16,31 @@
 #include <stddef.h>
 #include "hash.h"
 
+#define HEAP_NPOS  UINT32_MAX   // pos[] value of a pair that isn't queued
+
 typedef struct BPEHeapEntry {
   PairKey key;
   uint64_t freq;
-  uint32_t version;
+  uint32_t id;   // dense pair id, index into pos[]
 } BPEHeapEntry; // An entry in the heap
 
 typedef struct MaxHeap {
   BPEHeapEntry* data;  // array of heap entries
   size_t size;   // current no of elements
   size_t cap;    // allocation capacity MaxHeap
+  uint32_t* pos;   // pair id -> index into data, HEAP_NPOS if not queued
+  size_t npos;   // length of pos
 } MaxHeap;  // A simple max-heap over BPEHeapEntry
 
 extern "C" {
   // heap related functions
   void heap_init(MaxHeap* h, size_t capacity);
-  void heap_push(MaxHeap* h, PairKey key, uint64_t freq, uint32_t version);
+  void heap_update(MaxHeap* h, PairKey key, uint64_t freq, uint32_t id);  // insert or re-key in place
+  void heap_remove(MaxHeap* h, uint32_t id);  // no-op if the pair isn't queued
+  void heap_build(MaxHeap* h, const BPEHeapEntry* entries, size_t n);  // linear-time rebuild, shrinks the arrays
   BPEHeapEntry heap_pop(MaxHeap* h); // removes & returns top
   int heap_empty(MaxHeap* h);
   void heap_free(MaxHeap* h);
 }
 
-#endif  //!__HEAP__H__
\ No newline at end of file
+#endif  //!__HEAP__H__
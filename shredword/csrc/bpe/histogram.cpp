@@ -4,25 +4,20 @@
 #include "bpe.h"
 #include "hash.h"
 
+// writes one word into the packed token array, offsets[pos] must already be set
 void build_symbol_cb(const char* w, uint64_t count, void* u) {
   BuildCtx* ctx = (BuildCtx*)u;
   Trainer* trainer = ctx->trainer;
+  Corpus* corpus = &trainer->corpus;
   size_t pos = *(ctx->idx);
 
-  Symbol *head = NULL, *prev = NULL;
-  for (const unsigned char* p = (const unsigned char*)w; *p; ++p) {
-    Symbol* s = (Symbol*)malloc(sizeof(Symbol));
-    int32_t id = ctx->keep_char[*p] ? (int32_t)*p : trainer->config.unk_id;
-
-    s->id = id;
-    s->prev = prev;
-    s->next = NULL;
-    if (prev) prev->next = s;
-    else head = s;
-    prev = s;
+  size_t start = corpus->offsets[pos], len = 0;
+  for (const unsigned char* p = (const unsigned char*)w; *p; ++p, ++len) {
+    corpus->tokens[start + len] = ctx->keep_char[*p] ? (int32_t)*p : trainer->config.unk_id;
   }
-  trainer->corpus.words[pos] = head;
-  trainer->corpus.word_counts[pos] = count;
+  corpus->offsets[pos + 1] = start + len;
+  corpus->lengths[pos] = (uint32_t)len;
+  corpus->word_counts[pos] = count;
   (*(ctx->idx))++;
 }
 
@@ -43,31 +38,29 @@ void collect_char(const char* kc, uint64_t vc, void* u) {
   ctx->idx++;
 }
 
-// qsort comparator for CharCount descending
+// qsort comparator for CharCount descending, ties by byte value so the coverage
+// cut doesn't depend on map iteration order
 int charcount_cmp(const void *a, const void *b) {
   const CharCount *ca = (const CharCount*)a;
   const CharCount *cb = (const CharCount*)b;
   if (cb->count > ca->count) return 1;
   if (cb->count < ca->count) return -1;
-  return 0;
+  return (int)(unsigned char)ca->c - (int)(unsigned char)cb->c;
 }
 
 // --- helper called for each (key, count) --- 
 void load_entry(const char* key, uint64_t val, void* user) {
   struct load_ctx* ctx = (struct load_ctx*)user;
-  Symbol *head = NULL, *prev = NULL;
-  
-  // build linked list of raw bytes
-  for (const unsigned char* p = (const unsigned char*)key; *p; ++p) {
-    Symbol* s = (Symbol*)malloc(sizeof(Symbol));
-    s->id = (int32_t)*p;
-    s->prev = prev, s->next = NULL;
-    if (prev) prev->next = s;
-    else head = s;
-    prev = s;
+  Corpus* corpus = &ctx->trainer->corpus;
+
+  // copy raw bytes into the packed token array
+  size_t start = corpus->offsets[ctx->idx], len = 0;
+  for (const unsigned char* p = (const unsigned char*)key; *p; ++p, ++len) {
+    corpus->tokens[start + len] = (int32_t)*p;
   }
   // store into corpus
-  ctx->trainer->corpus.words[ctx->idx] = head;
-  ctx->trainer->corpus.word_counts[ctx->idx] = val;
+  corpus->offsets[ctx->idx + 1] = start + len;
+  corpus->lengths[ctx->idx] = (uint32_t)len;
+  corpus->word_counts[ctx->idx] = val;
   ctx->idx++;
 }
\ No newline at end of file
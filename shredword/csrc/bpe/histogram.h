@@ -5,12 +5,12 @@
    including:
   * - Building a character-level histogram from the corpus to estimate which characters
      should be retained based on a configured character coverage threshold.
-  * - Generating a symbol chain (linked list of Symbol structs) for each word, using either
+  * - Writing each word's symbols into the packed corpus token array, using either
      the original character ID or a fallback UNK token for rare characters.
   * - Sorting characters by frequency to determine inclusion into the vocabulary.
   * - Providing helper callbacks for StrMap iteration (word frequency, character histogram, etc.).
 
-  * This file decouples symbol chain construction and histogram logic from the main trainer module,
+  * This file decouples symbol array construction and histogram logic from the main trainer module,
   * making it easier to maintain and reuse for different subword algorithms.
 */
 
@@ -20,7 +20,6 @@
 #include "hash.h"
 
 typedef struct Trainer Trainer;   // forward declaration
-typedef struct Symbol Symbol;   // forward declaration
 
 struct load_ctx {
   Trainer* trainer;
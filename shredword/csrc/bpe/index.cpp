@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "index.h"
+
+#define INDEX_MIN_LIST 4
+
+static inline size_t index_slot(PairKey key, size_t nbuckets) {
+  return (size_t)pair_mix(pair_pack(key)) & (nbuckets - 1);
+}
+
+// --- double the bucket array once the index holds more pairs than buckets ---
+static void pairidx_grow(PairIndex* idx) {
+  size_t new_n = idx->nbuckets * 2;
+  IndexEntry** nb = (IndexEntry**)calloc(new_n, sizeof(IndexEntry*));
+  if (!nb) {
+    fprintf(stderr, "[ERROR]\t Pair index resize failed\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < idx->nbuckets; i++) {
+    IndexEntry* e = idx->buckets[i];
+    while (e) {
+      IndexEntry* next = e->next;
+      size_t s = index_slot(e->key, new_n);
+      e->next = nb[s];
+      nb[s] = e;
+      e = next;
+    }
+  }
+  free(idx->buckets);
+  idx->buckets = nb;
+  idx->nbuckets = new_n;
+}
+
+// --- Initialize the index with given bucket count (power of two) ---
+void pairidx_init(PairIndex* idx, size_t nbuckets) {
+  if (!idx) {
+    fprintf(stderr, "Pointer to Index not found!\n");
+    exit(EXIT_FAILURE);
+  }
+  idx->nbuckets = nbuckets;
+  idx->count = 0;
+  idx->buckets = (IndexEntry**)calloc(nbuckets, sizeof(IndexEntry*));
+  arena_init(&idx->nodes, 0);
+}
+
+// --- Return the word list for a pair, NULL if the pair was never indexed ---
+WordList* pairidx_find(const PairIndex* idx, PairKey key) {
+  if (!idx || !idx->buckets) return NULL;
+  for (IndexEntry* e = idx->buckets[index_slot(key, idx->nbuckets)]; e; e = e->next) {
+    if (e->key.first == key.first && e->key.second == key.second) return &e->list;
+  }
+  return NULL;
+}
+
+/**
+ @brief Record that `word` contains `key`.
+ * words are added one at a time while a word is scanned, so checking the
+   last element is enough to keep each list free of duplicates.
+*/
+void pairidx_add(PairIndex* idx, PairKey key, uint32_t word) {
+  WordList* list = pairidx_find(idx, key);
+  if (!list) {
+    if (idx->count >= idx->nbuckets) pairidx_grow(idx);
+    IndexEntry* e = (IndexEntry*)arena_alloc(&idx->nodes, sizeof(IndexEntry));
+    e->key = key;
+    e->list.words = NULL;
+    e->list.count = e->list.cap = 0;
+    size_t s = index_slot(key, idx->nbuckets);
+    e->next = idx->buckets[s];
+    idx->buckets[s] = e;
+    idx->count++;
+    list = &e->list;
+  }
+  if (list->count > 0 && list->words[list->count - 1] == word) return;
+  if (list->count == list->cap) {
+    size_t new_cap = list->cap ? list->cap * 2 : INDEX_MIN_LIST;
+    uint32_t* nw = (uint32_t*)realloc(list->words, new_cap * sizeof(uint32_t));
+    if (!nw) {
+      fprintf(stderr, "[ERROR]\t Pair index list reallocation failed\n");
+      exit(EXIT_FAILURE);
+    }
+    list->words = nw;
+    list->cap = new_cap;
+  }
+  list->words[list->count++] = word;
+}
+
+// --- Detach & return the list of a pair, leaving an empty list in its place ---
+WordList pairidx_take(PairIndex* idx, PairKey key) {
+  WordList out = {NULL, 0, 0};
+  WordList* list = pairidx_find(idx, key);
+  if (!list) return out;
+  out = *list;
+  list->words = NULL;
+  list->count = list->cap = 0;
+  return out;
+}
+
+/**
+ @brief Move every list of `src` onto the end of the matching list in `dst`.
+ * used to reduce thread-local indexes; merging them in thread order keeps each
+   list in ascending word order, same as a serial build. `src` is left empty.
+*/
+void pairidx_merge(PairIndex* dst, PairIndex* src) {
+  if (!dst || !src || !src->buckets) return;
+  for (size_t i = 0; i < src->nbuckets; i++) {
+    for (IndexEntry* e = src->buckets[i]; e; e = e->next) {
+      if (e->list.count == 0) continue;
+      WordList* list = pairidx_find(dst, e->key);
+      if (!list) {
+        pairidx_add(dst, e->key, e->list.words[0]);
+        list = pairidx_find(dst, e->key);
+        free(list->words);
+        *list = e->list;  // steal the array, no copy
+      } else {
+        for (size_t k = 0; k < e->list.count; k++) pairidx_add(dst, e->key, e->list.words[k]);
+        free(e->list.words);
+      }
+      e->list.words = NULL;
+      e->list.count = e->list.cap = 0;
+    }
+  }
+}
+
+// --- Free all resources held by the index ---
+void pairidx_free(PairIndex* idx) {
+  if (!idx || !idx->buckets) return;
+  for (size_t i = 0; i < idx->nbuckets; i++) {
+    for (IndexEntry* e = idx->buckets[i]; e; e = e->next) free(e->list.words);
+  }
+  arena_free(&idx->nodes);
+  free(idx->buckets);
+  idx->buckets = NULL;
+  idx->nbuckets = idx->count = 0;
+}
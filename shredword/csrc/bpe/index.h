@@ -0,0 +1,48 @@
+/**
+ @file index.h
+ @brief pair-occurrence index for BPE merges.
+
+ * maps every bigram (PairKey) to the list of words that contain it, so a merge
+    only has to visit the words holding the winning pair instead of the whole corpus.
+ * lists are append-only & may hold words that no longer contain the pair (stale),
+    callers re-check the symbols while walking a word.
+ * entries are never removed on their own, so they come from an arena instead of
+    one malloc each.
+*/
+
+#ifndef __PAIR_INDEX_H__
+#define __PAIR_INDEX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.h"
+#include "../inc/arena.h"
+
+typedef struct WordList {
+  uint32_t* words;  // indices into corpus word table
+  size_t count, cap;
+} WordList;
+
+typedef struct IndexEntry {
+  PairKey key;
+  WordList list;
+  struct IndexEntry* next;
+} IndexEntry;
+
+typedef struct PairIndex {
+  IndexEntry** buckets;
+  size_t nbuckets;  // always a power of two
+  size_t count;   // no of distinct pairs in the index
+  Arena nodes;  // IndexEntry storage, released in one go by pairidx_free
+} PairIndex;
+
+extern "C" {
+  void pairidx_init(PairIndex* idx, size_t nbuckets);
+  WordList* pairidx_find(const PairIndex* idx, PairKey key);
+  void pairidx_add(PairIndex* idx, PairKey key, uint32_t word);
+  WordList pairidx_take(PairIndex* idx, PairKey key);   // detaches the list, caller frees `words`
+  void pairidx_merge(PairIndex* dst, PairIndex* src);   // moves all lists of `src` to the end of `dst`
+  void pairidx_free(PairIndex* idx);
+}
+
+#endif  //!__PAIR_INDEX_H__
@@ -0,0 +1,103 @@
+/**
+ @file arena.h
+ @brief chunked bump allocator for many small, same-lifetime objects.
+
+ * objects are carved out of large blocks & released all at once, either by
+    arena_reset (blocks are kept for reuse) or arena_free.
+ * counters record how many objects were served vs how many blocks had to be
+    malloc'd, so callers can report the saved allocations.
+ * not thread-safe, give every thread its own arena.
+*/
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGN  16
+#define ARENA_DEFAULT_BLOCK  (64 << 10)
+
+typedef struct ArenaBlock {
+  struct ArenaBlock* next;
+  size_t used, cap;   // bytes handed out / available after the header
+} ArenaBlock;
+
+typedef struct Arena {
+  ArenaBlock* head;   // block currently served from, older blocks follow
+  ArenaBlock* spare;  // blocks released by arena_reset, reused before any malloc
+  size_t block_size;
+  uint64_t allocs;  // objects served
+  uint64_t blocks;  // blocks malloc'd
+  uint64_t resets;  // bulk releases
+} Arena;
+
+static inline void arena_init(Arena* a, size_t block_size) {
+  a->head = a->spare = NULL;
+  a->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+  a->allocs = a->blocks = a->resets = 0;
+}
+
+// --- return `size` bytes (ARENA_ALIGN aligned, uninitialised) ---
+static inline void* arena_alloc(Arena* a, size_t size) {
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  ArenaBlock* b = a->head;
+  if (!b || b->cap - b->used < size) {
+    if (a->spare && a->spare->cap >= size) {
+      b = a->spare;
+      a->spare = b->next;
+    } else {
+      size_t cap = size > a->block_size ? size : a->block_size;
+      b = (ArenaBlock*)malloc(sizeof(ArenaBlock) + ARENA_ALIGN + cap);
+      if (!b) {
+        fprintf(stderr, "[ERROR]\t Arena block allocation failed\n");
+        exit(EXIT_FAILURE);
+      }
+      b->cap = cap;
+      a->blocks++;
+    }
+    b->used = 0;
+    b->next = a->head;
+    a->head = b;
+  }
+  uintptr_t base = ((uintptr_t)(b + 1) + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+  void* p = (void*)(base + b->used);
+  b->used += size;
+  a->allocs++;
+  return p;
+}
+
+// --- release every object at once, blocks are kept for the next round ---
+static inline void arena_reset(Arena* a) {
+  while (a->head) {
+    ArenaBlock* n = a->head->next;
+    a->head->next = a->spare;
+    a->spare = a->head;
+    a->head = n;
+  }
+  a->resets++;
+}
+
+static inline void arena_free(Arena* a) {
+  ArenaBlock* lists[2] = {a->head, a->spare};
+  for (int i = 0; i < 2; i++) {
+    ArenaBlock* b = lists[i];
+    while (b) {
+      ArenaBlock* n = b->next;
+      free(b);
+      b = n;
+    }
+  }
+  a->head = a->spare = NULL;
+}
+
+// --- fold the counters of a (thread-local) arena into `dst` ---
+static inline void arena_add_stats(Arena* dst, const Arena* src) {
+  dst->allocs += src->allocs;
+  dst->blocks += src->blocks;
+  dst->resets += src->resets;
+}
+
+#endif  //!__ARENA_H__
@@ -0,0 +1,93 @@
+/**
+ @file mapfile.h
+ @brief read-only memory mapping of a whole input file.
+
+ * mmap on POSIX, CreateFileMapping/MapViewOfFile on Windows.
+ * the mapping is not NUL-terminated, callers scan it with explicit bounds.
+*/
+
+#ifndef __MAPFILE_H__
+#define __MAPFILE_H__
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+typedef struct MappedFile {
+  const char* data;   // NULL for an empty file
+  size_t size;
+} MappedFile;
+
+// --- map `path` read-only, returns 0 on success & -1 (with an error printed) otherwise ---
+static inline int map_file(const char* path, MappedFile* mf) {
+  mf->data = NULL, mf->size = 0;
+#ifdef _WIN32
+  HANDLE fh = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (fh == INVALID_HANDLE_VALUE) {
+    fprintf(stderr, "[ERROR]\t Couldn't open file: %s\n", path);
+    return -1;
+  }
+  LARGE_INTEGER sz;
+  if (!GetFileSizeEx(fh, &sz)) {
+    fprintf(stderr, "[ERROR]\t Couldn't stat file: %s\n", path);
+    CloseHandle(fh);
+    return -1;
+  }
+  mf->size = (size_t)sz.QuadPart;
+  if (mf->size > 0) {
+    HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mh) {
+      mf->data = (const char*)MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mh);
+    }
+  }
+  CloseHandle(fh);
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "[ERROR]\t Couldn't open file: %s\n", path);
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    fprintf(stderr, "[ERROR]\t Couldn't stat file: %s\n", path);
+    close(fd);
+    return -1;
+  }
+  mf->size = (size_t)st.st_size;
+  if (mf->size > 0) {
+    void* p = mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      madvise(p, mf->size, MADV_SEQUENTIAL);
+      mf->data = (const char*)p;
+    }
+  }
+  close(fd);
+#endif
+  if (mf->size > 0 && !mf->data) {
+    fprintf(stderr, "[ERROR]\t Couldn't map file: %s\n", path);
+    mf->size = 0;
+    return -1;
+  }
+  return 0;
+}
+
+static inline void unmap_file(MappedFile* mf) {
+  if (!mf->data) return;
+#ifdef _WIN32
+  UnmapViewOfFile((LPCVOID)mf->data);
+#else
+  munmap((void*)mf->data, mf->size);
+#endif
+  mf->data = NULL, mf->size = 0;
+}
+
+#endif  //!__MAPFILE_H__
@@ -0,0 +1,55 @@
+/**
+ @file threads.h
+ @brief tiny fork/join helpers shared by the BPE & Unigram trainers.
+
+ * work is split into contiguous [begin, end) ranges, one per thread, so callers
+    can keep thread-local state per range & reduce it in thread order afterwards
+    (which keeps results identical to the serial path).
+ * C++ only (std::thread), the rest of the API stays plain C.
+*/
+
+#ifndef __THREADS_H__
+#define __THREADS_H__
+
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+// resolve a user thread setting, <= 0 means "all hardware threads"
+static inline int resolve_threads(int requested) {
+  if (requested > 0) return requested;
+  unsigned hw = std::thread::hardware_concurrency();
+  return hw ? (int)hw : 1;
+}
+
+// no of threads worth spawning for `n` items when each thread should get at least `min_per_thread`
+static inline int threads_for(size_t n, int threads, size_t min_per_thread) {
+  if (threads <= 1 || min_per_thread == 0) return threads < 1 ? 1 : threads;
+  size_t useful = n / min_per_thread;
+  if (useful < 1) useful = 1;
+  return (size_t)threads < useful ? threads : (int)useful;
+}
+
+/**
+ @brief Run fn(tid, begin, end) over [0, n) split into `threads` contiguous ranges.
+ * thread 0 runs on the calling thread; with threads <= 1 this is a plain call.
+*/
+template <typename F>
+static inline void parallel_for(size_t n, int threads, F fn) {
+  if (threads <= 1 || n < 2) { fn(0, (size_t)0, n); return; }
+  if ((size_t)threads > n) threads = (int)n;
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  size_t chunk = n / threads, rem = n % threads, begin = 0;
+  size_t first_end = chunk + (rem > 0 ? 1 : 0);
+  begin = first_end;
+  for (int t = 1; t < threads; t++) {
+    size_t len = chunk + ((size_t)t < rem ? 1 : 0);
+    pool.emplace_back(fn, t, begin, begin + len);
+    begin += len;
+  }
+  fn(0, (size_t)0, first_end);
+  for (auto& th : pool) th.join();
+}
+
+#endif  //!__THREADS_H__
@@ -3,11 +3,13 @@
  * main CLI interface for training vocabs directly, by selecting b/w the bpe or unigram models
  * 
  * compile this file:
- *    - windows: g++ -o trainer.exe trainer.cpp bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp unigram/unigram.cpp unigram/heap.cpp unigram/cache.cpp unigram/hashmap.cpp unigram/subword.cpp trie.cpp -I. -std=c++11
- *    - linux: g++ -o trainer.exe trainer.cpp bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp unigram/unigram.cpp unigram/heap.cpp unigram/cache.cpp unigram/hashmap.cpp unigram/subword.cpp trie.cpp
+ *    - windows: g++ -o trainer.exe trainer.cpp bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp bpe/index.cpp bpe/bucket.cpp unigram/unigram.cpp unigram/heap.cpp unigram/cache.cpp unigram/hashmap.cpp unigram/subword.cpp trie.cpp -I. -std=c++11
+ *    - linux: g++ -o trainer.exe trainer.cpp bpe/bpe.cpp bpe/histogram.cpp bpe/hash.cpp bpe/heap.cpp bpe/index.cpp bpe/bucket.cpp unigram/unigram.cpp unigram/heap.cpp unigram/cache.cpp unigram/hashmap.cpp unigram/subword.cpp trie.cpp -pthread
  * 
  * run:
  *    - as bpe: trainer.exe input=corpus.txt model_type=bpe output_model=model.bin output_vocab=vocab.txt vocab_size=32000
+ *    - extend bpe: trainer.exe input=corpus.txt init_model=model_32k.bin model_type=bpe output_model=model.bin output_vocab=vocab.txt vocab_size=64000
+ *    - resume bpe: trainer.exe resume=run.ckpt model_type=bpe output_model=model.bin output_vocab=vocab.txt vocab_size=32000
  *    - as unigram: trainer.exe input=corpus.txt model_type=unigram output_model=model.bin output_vocab=vocab.txt vocab_size=32000 
  */
 
@@ -20,11 +22,18 @@
 #include "unigram/heap.h"
 
 typedef struct CLIConfig {
-  char *input_path, *output_model, *output_vocab, *model_type;
+  char *input_path, *output_model, *output_vocab, *model_type, *checkpoint, *resume, *word_cache, *snapshots, *snapshot_prefix, *init_model;
   int vocab_size, num_iterations, seed_size, max_piece_length;
   float character_coverage;
   uint64_t min_pair_freq;
   int32_t unk_id;
+  uint32_t verify_every;
+  int32_t num_threads;
+  int32_t pair_queue;
+  uint32_t checkpoint_every;
+  size_t word_budget_mb;
+  uint64_t min_word_freq;
+  int32_t multi_merge;
 } CLIConfig;
 
 void print_usage(const char* program_name) {
@@ -38,13 +47,29 @@ void print_usage(const char* program_name) {
   printf("  character_coverage=<float> Coverage 0.0-1.0 (default: 0.9995)\n");
   printf("  min_pair_freq=<int>       Min pair freq BPE (default: 2000)\n");
   printf("  num_iterations=<int>      Iterations Unigram (default: 10)\n");
+  printf("  verify_every=<int>        BPE debug: recount merged pair every N merges (default: 0, off)\n");
+  printf("  threads=<int>             BPE loading, counting & merge threads, Unigram E-step threads (default: 0, all cores)\n");
+  printf("  pair_queue=<heap|bucket>  BPE pair selection structure (default: heap)\n");
+  printf("  checkpoint=<path>         BPE: write a resumable checkpoint while training\n");
+  printf("  checkpoint_every=<int>    BPE: merges between checkpoints (default: 1000)\n");
+  printf("  resume=<path>             BPE: continue from a checkpoint instead of loading input\n");
+  printf("  init_model=<path>         BPE: start from the merges of an existing model & extend it to vocab_size\n");
+  printf("  word_cache=<path>         BPE: load words from this cache, built from input if missing\n");
+  printf("  snapshots=<int,int,...>   BPE: also save the model at these vocab sizes\n");
+  printf("  snapshot_prefix=<path>    BPE: snapshots go to <prefix>_<size>.bin/.vocab (default: output_model without extension)\n");
+  printf("  word_budget_mb=<int>      BPE: cap the word table at this many MB while counting, rare words are dropped (default: 0, no cap)\n");
+  printf("  min_word_freq=<int>       BPE: drop words seen fewer times before training (default: 0, keep all)\n");
+  printf("  multi_merge=<0|1>         BPE: apply runs of non-conflicting top pairs in one pass, same merges (default: 0)\n");
 }
 
 void init_config(CLIConfig* config) {
   config->input_path = config->output_model = config->output_vocab = config->model_type = NULL;
+  config->checkpoint = config->resume = config->word_cache = NULL, config->checkpoint_every = 1000;
+  config->snapshots = config->snapshot_prefix = config->init_model = NULL;
+  config->word_budget_mb = 0, config->min_word_freq = 0, config->multi_merge = 0;
   config->vocab_size = 32000, config->num_iterations = 10, config->seed_size = 1000000;
   config->max_piece_length = 16, config->character_coverage = 0.9995f;
-  config->min_pair_freq = 2000, config->unk_id = -1;
+  config->min_pair_freq = 2000, config->unk_id = -1, config->verify_every = 0, config->num_threads = 0, config->pair_queue = PAIR_QUEUE_HEAP;
 }
 
 int parse_args(int argc, char** argv, CLIConfig* config) {
@@ -65,9 +90,22 @@ int parse_args(int argc, char** argv, CLIConfig* config) {
     else if (strcmp(key, "num_iterations") == 0) config->num_iterations = atoi(value);
     else if (strcmp(key, "seed_size") == 0) config->seed_size = atoi(value);
     else if (strcmp(key, "max_piece_length") == 0) config->max_piece_length = atoi(value);
+    else if (strcmp(key, "verify_every") == 0) config->verify_every = (uint32_t)atoi(value);
+    else if (strcmp(key, "threads") == 0) config->num_threads = (int32_t)atoi(value);
+    else if (strcmp(key, "pair_queue") == 0) config->pair_queue = strcmp(value, "bucket") == 0 ? PAIR_QUEUE_BUCKET : PAIR_QUEUE_HEAP;
+    else if (strcmp(key, "checkpoint") == 0) config->checkpoint = strdup(value);
+    else if (strcmp(key, "checkpoint_every") == 0) config->checkpoint_every = (uint32_t)atoi(value);
+    else if (strcmp(key, "resume") == 0) config->resume = strdup(value);
+    else if (strcmp(key, "word_cache") == 0) config->word_cache = strdup(value);
+    else if (strcmp(key, "snapshots") == 0) config->snapshots = strdup(value);
+    else if (strcmp(key, "snapshot_prefix") == 0) config->snapshot_prefix = strdup(value);
+    else if (strcmp(key, "init_model") == 0) config->init_model = strdup(value);
+    else if (strcmp(key, "word_budget_mb") == 0) config->word_budget_mb = (size_t)atoll(value);
+    else if (strcmp(key, "min_word_freq") == 0) config->min_word_freq = (uint64_t)atoll(value);
+    else if (strcmp(key, "multi_merge") == 0) config->multi_merge = (int32_t)atoi(value);
   }
 
-  if (!config->input_path || !config->model_type || !config->output_model || !config->output_vocab) {
+  if ((!config->input_path && !config->resume && !config->word_cache) || !config->model_type || !config->output_model || !config->output_vocab) {
     fprintf(stderr, "[ERROR] Missing required arguments\n\n");
     print_usage(argv[0]);
     return -1;
@@ -78,29 +116,111 @@ int parse_args(int argc, char** argv, CLIConfig* config) {
     return -1;
   }
 
+  if (!config->input_path && strcmp(config->model_type, "bpe") != 0) {
+    fprintf(stderr, "[ERROR] resume & word_cache without input are only supported for model_type=bpe\n");
+    return -1;
+  }
+
   return 1;
 }
 
+// --- parse the comma separated `snapshots` list & hand it to the trainer ---
+int set_snapshots(Trainer* trainer, const CLIConfig* config) {
+  size_t n = 1;
+  for (const char* p = config->snapshots; *p; p++) n += *p == ',';
+  size_t* sizes = (size_t*)malloc(n * sizeof(size_t));
+  if (!sizes) { fprintf(stderr, "[ERROR] Failed to allocate snapshot list\n"); return -1; }
+  size_t count = 0;
+  for (const char* p = config->snapshots; *p;) {
+    char* end;
+    long v = strtol(p, &end, 10);
+    if (end == p || v <= 0) {
+      fprintf(stderr, "[ERROR] Invalid snapshots list: %s\n", config->snapshots);
+      free(sizes);
+      return -1;
+    }
+    sizes[count++] = (size_t)v;
+    p = *end == ',' ? end + 1 : end;
+  }
+  char* prefix = config->snapshot_prefix ? strdup(config->snapshot_prefix) : strdup(config->output_model);
+  if (!config->snapshot_prefix) {
+    char* dot = strrchr(prefix, '.');
+    char* slash = strrchr(prefix, '/');
+    char* bslash = strrchr(prefix, '\\');
+    if (bslash && (!slash || bslash > slash)) slash = bslash;
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+  }
+  printf("[CONFIG] Snapshots: %s -> %s_<size>.bin\n", config->snapshots, prefix);
+  int rc = bpe_set_snapshots(trainer, sizes, count, prefix);
+  free(sizes);
+  free(prefix);
+  return rc;
+}
+
 int train_bpe(const CLIConfig* config) {
   printf("\n========== BPE Training ==========\n");
   printf("[CONFIG] Vocab Size: %d\n", config->vocab_size);
   printf("[CONFIG] Character Coverage: %.4f\n", config->character_coverage);
   printf("[CONFIG] Min Pair Freq: %llu\n", (unsigned long long)config->min_pair_freq);
 
-  BPEConfig bpe_config = {(size_t)config->vocab_size, config->unk_id, config->character_coverage, config->min_pair_freq};
+  if (config->verify_every) printf("[CONFIG] Verify Every: %u merges\n", config->verify_every);
+  if (config->num_threads > 0) printf("[CONFIG] Threads: %d\n", config->num_threads);
+  if (config->pair_queue == PAIR_QUEUE_BUCKET) printf("[CONFIG] Pair Queue: bucket\n");
+  if (config->checkpoint) printf("[CONFIG] Checkpoint: %s every %u merges\n", config->checkpoint, config->checkpoint_every);
+  if (config->word_budget_mb) printf("[CONFIG] Word Budget: %zu MB\n", config->word_budget_mb);
+  if (config->min_word_freq) printf("[CONFIG] Min Word Freq: %llu\n", (unsigned long long)config->min_word_freq);
+  if (config->multi_merge) printf("[CONFIG] Multi Merge: on\n");
+
+  BPEConfig bpe_config = {(size_t)config->vocab_size, config->unk_id, config->character_coverage, config->min_pair_freq, config->verify_every, config->num_threads, config->pair_queue,
+                          config->word_budget_mb << 20, config->min_word_freq, config->multi_merge};
   Trainer* trainer = create_trainer(&bpe_config);
   if (!trainer) { fprintf(stderr, "[ERROR] Failed to create BPE trainer\n"); return -1; }
 
-  printf("\n[STEP 1] Loading corpus from: %s\n", config->input_path);
-  if (bpe_load_corpus(trainer, config->input_path) != 0) {
-    fprintf(stderr, "[ERROR] Failed to load corpus\n");
+  if (config->checkpoint) bpe_set_checkpoint(trainer, config->checkpoint, config->checkpoint_every);
+  if (config->snapshots && set_snapshots(trainer, config) != 0) {
     bpe_trainer_destroy(trainer);
     return -1;
   }
-  printf("[INFO] Corpus loaded successfully. Vocabulary: %zu words\n", trainer->corpus.vocab_size);
 
-  printf("\n[STEP 2] Training BPE model...\n");
-  int merges = bpe_train(trainer);
+  int merges;
+  if (config->resume) {
+    printf("\n[STEP 1] Resuming from checkpoint: %s\n", config->resume);
+    printf("\n[STEP 2] Training BPE model...\n");
+    merges = bpe_resume(trainer, config->resume);
+  } else {
+    int loaded;
+    if (config->word_cache) {
+      FILE* cf = fopen(config->word_cache, "rb");
+      if (cf) fclose(cf);
+      else if (!config->input_path || bpe_build_word_cache(config->input_path, config->word_cache, config->num_threads) != 0) {
+        fprintf(stderr, "[ERROR] Word cache %s is missing and could not be built from input\n", config->word_cache);
+        bpe_trainer_destroy(trainer);
+        return -1;
+      }
+      printf("\n[STEP 1] Loading corpus from word cache: %s\n", config->word_cache);
+      loaded = bpe_load_word_cache(trainer, config->word_cache);
+    } else {
+      printf("\n[STEP 1] Loading corpus from: %s\n", config->input_path);
+      loaded = bpe_load_corpus(trainer, config->input_path);
+    }
+    if (loaded != 0) {
+      fprintf(stderr, "[ERROR] Failed to load corpus\n");
+      bpe_trainer_destroy(trainer);
+      return -1;
+    }
+    printf("[INFO] Corpus loaded successfully. Vocabulary: %zu words\n", trainer->corpus.vocab_size);
+    if (config->init_model) {
+      printf("[INFO] Continuing from model: %s\n", config->init_model);
+      if (bpe_load_model(trainer, config->init_model) != 0) {
+        fprintf(stderr, "[ERROR] Failed to load initial model\n");
+        bpe_trainer_destroy(trainer);
+        return -1;
+      }
+    }
+
+    printf("\n[STEP 2] Training BPE model...\n");
+    merges = bpe_train(trainer);
+  }
   if (merges < 0) {
     fprintf(stderr, "[ERROR] Training failed\n");
     bpe_trainer_destroy(trainer);
@@ -123,8 +243,9 @@ int train_unigram(const CLIConfig* config) {
   printf("[CONFIG] Character Coverage: %.4f\n", config->character_coverage);
   printf("[CONFIG] Max Piece Length: %d\n", config->max_piece_length);
   printf("[CONFIG] Iterations: %d\n", config->num_iterations);
+  if (config->num_threads > 0) printf("[CONFIG] Threads: %d\n", config->num_threads);
 
-  UnigramTrainer* trainer = trainerCreate(config->vocab_size, config->character_coverage, config->max_piece_length, config->seed_size);
+  UnigramTrainer* trainer = trainerCreate(config->vocab_size, config->character_coverage, config->max_piece_length, config->seed_size, config->num_threads);
   if (!trainer) { fprintf(stderr, "[ERROR] Failed to create Unigram trainer\n"); return -1; }
 
   printf("\n[STEP 1] Loading corpus from: %s\n", config->input_path);
@@ -197,6 +318,12 @@ int main(int argc, char** argv) {
     if (config.model_type) free(config.model_type);
     if (config.output_model) free(config.output_model);
     if (config.output_vocab) free(config.output_vocab);
+    if (config.checkpoint) free(config.checkpoint);
+    if (config.resume) free(config.resume);
+    if (config.word_cache) free(config.word_cache);
+    if (config.snapshots) free(config.snapshots);
+    if (config.snapshot_prefix) free(config.snapshot_prefix);
+    if (config.init_model) free(config.init_model);
     return 1;
   }
 
@@ -208,6 +335,12 @@ int main(int argc, char** argv) {
   if (config.model_type) free(config.model_type);
   if (config.output_model) free(config.output_model);
   if (config.output_vocab) free(config.output_vocab);
+  if (config.checkpoint) free(config.checkpoint);
+  if (config.resume) free(config.resume);
+  if (config.word_cache) free(config.word_cache);
+  if (config.snapshots) free(config.snapshots);
+  if (config.snapshot_prefix) free(config.snapshot_prefix);
+  if (config.init_model) free(config.init_model);
 
   return result;
 }
\ No newline at end of file
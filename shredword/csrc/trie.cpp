@@ -6,89 +6,172 @@
 #include <stdlib.h>
 #include "trie.h"
 
-static TrieNode* trieNodeCreate() {
-  TrieNode* node = (TrieNode*)calloc(1, sizeof(TrieNode));
-  if (!node) return NULL;
-  node->is_token = false;
+// --- take a node off the free list or the end of the array, TRIE_NONE when out of memory ---
+static uint32_t trieNodeAlloc(SubwordTrie* trie, unsigned char label) {
+  uint32_t idx = trie->free_list;
+  if (idx != TRIE_NONE) {
+    trie->free_list = trie->nodes[idx].next;
+  } else {
+    if (trie->node_count >= trie->node_capacity) {
+      int new_capacity = trie->node_capacity * 2;
+      TrieNode* new_nodes = (TrieNode*)realloc(trie->nodes, sizeof(TrieNode) * new_capacity);
+      if (!new_nodes) return TRIE_NONE;
+      trie->nodes = new_nodes, trie->node_capacity = new_capacity;
+    }
+    idx = (uint32_t)trie->node_count++;
+  }
+  TrieNode* node = &trie->nodes[idx];
+  node->child = node->next = TRIE_NONE;
   node->freq = 0;
-  return node;
+  node->score = 0.0;
+  node->label = label;
+  node->is_token = false;
+  return idx;
+}
+
+static void trieNodeRelease(SubwordTrie* trie, uint32_t idx) {
+  trie->nodes[idx].next = trie->free_list;
+  trie->free_list = idx;
+}
+
+static inline uint32_t trieFindChild(const SubwordTrie* trie, uint32_t node, unsigned char c) {
+  if (node == 0) return trie->root_children[c];
+  uint32_t cur = trie->nodes[node].child;
+  while (cur != TRIE_NONE && trie->nodes[cur].label < c) cur = trie->nodes[cur].next;
+  return (cur != TRIE_NONE && trie->nodes[cur].label == c) ? cur : TRIE_NONE;
 }
 
-static void trieNodeDestroy(TrieNode* node) {
-  if (!node) return;
-  for (int i = 0; i < TRIE_CHILDREN; i++) {
-    if (node->children[i]) trieNodeDestroy(node->children[i]);
+// --- child `c` of `node`, created in its sorted place if missing ---
+static uint32_t trieGetChild(SubwordTrie* trie, uint32_t node, unsigned char c) {
+  if (node == 0) {
+    if (trie->root_children[c] == TRIE_NONE) trie->root_children[c] = trieNodeAlloc(trie, c);
+    return trie->root_children[c];
   }
-  free(node);
+  uint32_t prev = TRIE_NONE, cur = trie->nodes[node].child;
+  while (cur != TRIE_NONE && trie->nodes[cur].label < c) prev = cur, cur = trie->nodes[cur].next;
+  if (cur != TRIE_NONE && trie->nodes[cur].label == c) return cur;
+  uint32_t idx = trieNodeAlloc(trie, c);
+  if (idx == TRIE_NONE) return TRIE_NONE;
+  trie->nodes[idx].next = cur;
+  if (prev == TRIE_NONE) trie->nodes[node].child = idx;
+  else trie->nodes[prev].next = idx;
+  return idx;
+}
+
+static uint32_t trieLocate(const SubwordTrie* trie, const char* token) {
+  uint32_t node = 0;
+  for (const char* p = token; *p && node != TRIE_NONE; p++) node = trieFindChild(trie, node, (unsigned char)*p);
+  return node;
 }
 
 SubwordTrie* trieCreate() {
   SubwordTrie* trie = (SubwordTrie*)malloc(sizeof(SubwordTrie));
   if (!trie) return NULL;
-  trie->root = trieNodeCreate();
+  trie->nodes = (TrieNode*)malloc(sizeof(TrieNode) * TRIE_INITIAL_NODES);
+  if (!trie->nodes) { free(trie); return NULL; }
+  trie->node_count = 0, trie->node_capacity = TRIE_INITIAL_NODES;
+  trie->free_list = TRIE_NONE;
+  for (int i = 0; i < TRIE_CHILDREN; i++) trie->root_children[i] = TRIE_NONE;
   trie->total_tokens = 0;
+  trieNodeAlloc(trie, 0);
   return trie;
 }
 
 void trieDestroy(SubwordTrie* trie) {
   if (!trie) return;
-  trieNodeDestroy(trie->root);
+  free(trie->nodes);
   free(trie);
 }
 
 bool trieInsert(SubwordTrie* trie, const char* token, int freq) {
   if (!trie || !token || freq < 0 || strlen(token) == 0 || strlen(token) >= MAX_TOKEN_LENGTH) return false;
-  TrieNode* node = trie->root;
+  uint32_t node = 0;
   for (const char* p = token; *p; p++) {
-    unsigned char c = (unsigned char)*p;
-    if (!node->children[c]) {
-      node->children[c] = trieNodeCreate();
-      if (!node->children[c]) return false;
-    }
-    node = node->children[c];
+    node = trieGetChild(trie, node, (unsigned char)*p);
+    if (node == TRIE_NONE) return false;
   }
 
-  if (!node->is_token) trie->total_tokens++;
-  node->is_token = true;
-  node->freq = freq;
+  if (!trie->nodes[node].is_token) trie->total_tokens++;
+  trie->nodes[node].is_token = true;
+  trie->nodes[node].freq = freq;
   return true;
 }
 
-int trieSearch(SubwordTrie* trie, const char* token) {
-  if (!trie || !token) return -1;
-
-  TrieNode* node = trie->root;
-  for (const char* p = token; *p; p++) {
-    unsigned char c = (unsigned char)*p;
-    if (!node->children[c]) return -1;
-    node = node->children[c];
+/**
+  @brief Bulk load `count` tokens sorted by strcmp into an empty trie.
+  * every new node is the last child of its parent, so nodes are appended along the
+    path shared with the previous token, without searching any sibling chain.
+  * a non-empty trie or out of order / duplicate tokens fall back to trieInsert.
+  * `scores` may be NULL, tokens then start with a score of 0.
+  * returns false if any token was rejected (same rules as trieInsert).
+ */
+bool trieBuild(SubwordTrie* trie, const char** tokens, const int* freqs, const double* scores, int count) {
+  if (!trie || !tokens || !freqs || count < 0) return false;
+  bool ok = true, ordered = trie->total_tokens == 0 && trie->node_count == 1;
+  uint32_t path[MAX_TOKEN_LENGTH];  // path[d]: node of the previous token at depth d + 1
+  const char* prev = "";
+  int prev_len = 0;
+  for (int i = 0; i < count; i++) {
+    const char* token = tokens[i];
+    int len = token ? (int)strlen(token) : 0;
+    if (!token || freqs[i] < 0 || len == 0 || len >= MAX_TOKEN_LENGTH) { ok = false; continue; }
+    if (ordered && prev_len > 0 && strcmp(prev, token) >= 0) ordered = false;
+    if (!ordered) {
+      ok = trieInsert(trie, token, freqs[i]) && ok;
+      if (scores) trieUpdateScore(trie, token, scores[i]);
+      continue;
+    }
+    int lcp = 0;
+    while (lcp < prev_len && prev[lcp] == token[lcp]) lcp++;
+    for (int d = lcp; d < len; d++) {
+      uint32_t idx = trieNodeAlloc(trie, (unsigned char)token[d]);
+      if (idx == TRIE_NONE) return false;
+      if (d == 0) trie->root_children[(unsigned char)token[0]] = idx;
+      else if (d == lcp && d < prev_len) trie->nodes[path[d]].next = idx;  // after the previous token's node at this depth
+      else trie->nodes[path[d - 1]].child = idx;
+      path[d] = idx;
+    }
+    trie->nodes[path[len - 1]].is_token = true;
+    trie->nodes[path[len - 1]].freq = freqs[i];
+    trie->nodes[path[len - 1]].score = scores ? scores[i] : 0.0;
+    trie->total_tokens++;
+    prev = token, prev_len = len;
   }
-  return node->is_token ? node->freq : -1;
+  return ok;
 }
 
-static bool trieNodeHasChildren(TrieNode* node) {
-  if (!node) return false;
-  for (int i = 0; i < TRIE_CHILDREN; i++) { if (node->children[i]) return true; }
-  return false;
+int trieSearch(SubwordTrie* trie, const char* token) {
+  if (!trie || !token) return -1;
+  uint32_t node = trieLocate(trie, token);
+  if (node == TRIE_NONE) return -1;
+  return trie->nodes[node].is_token ? trie->nodes[node].freq : -1;
 }
 
-static bool trieRemoveHelper(TrieNode* node, const char* token, int depth) {
-  if (!node) return false;
+static bool trieRemoveHelper(SubwordTrie* trie, uint32_t node, const char* token, int depth) {
   if (token[depth] == '\0') {
-    if (!node->is_token) return false;
-    node->is_token = false;
-    node->freq = 0;
-    return !trieNodeHasChildren(node);
+    if (!trie->nodes[node].is_token) return false;
+    trie->nodes[node].is_token = false;
+    trie->nodes[node].freq = 0;
+    trie->nodes[node].score = 0.0;
+    return trie->nodes[node].child == TRIE_NONE;
   }
   unsigned char c = (unsigned char)token[depth];
-  TrieNode* child = node->children[c];
-  if (!child) return false;
-  bool should_delete_child = trieRemoveHelper(child, token, depth + 1);
+  uint32_t child = trieFindChild(trie, node, c);
+  if (child == TRIE_NONE) return false;
+  bool should_delete_child = trieRemoveHelper(trie, child, token, depth + 1);
   if (should_delete_child) {
-    trieNodeDestroy(child);
-    node->children[c] = NULL;
+    if (node == 0) {
+      trie->root_children[c] = TRIE_NONE;
+    } else if (trie->nodes[node].child == child) {
+      trie->nodes[node].child = trie->nodes[child].next;
+    } else {
+      uint32_t prev = trie->nodes[node].child;
+      while (trie->nodes[prev].next != child) prev = trie->nodes[prev].next;
+      trie->nodes[prev].next = trie->nodes[child].next;
+    }
+    trieNodeRelease(trie, child);
   }
-  return !node->is_token && !trieNodeHasChildren(node);
+  return node != 0 && !trie->nodes[node].is_token && trie->nodes[node].child == TRIE_NONE;
 }
 
 bool trieContains(SubwordTrie *trie, const char *token) {
@@ -102,29 +185,61 @@ int trieGetTokenCount(SubwordTrie *trie) {
 bool trieRemove(SubwordTrie* trie, const char* token) {
   if (!trie || !token) return false;
   if (!trieContains(trie, token)) return false;
-  trieRemoveHelper(trie->root, token, 0);
+  trieRemoveHelper(trie, 0, token, 0);
   trie->total_tokens--;
   return true;
 }
 
 bool trieUpdateFreq(SubwordTrie* trie, const char* token, int new_freq) {
   if (!trie || !token || new_freq < 0) return false;
+  uint32_t node = trieLocate(trie, token);
+  if (node == TRIE_NONE || !trie->nodes[node].is_token) return false;
+  trie->nodes[node].freq = new_freq;
+  return true;
+}
 
-  TrieNode* node = trie->root;
-  for (const char* p = token; *p; p++) {
-    unsigned char c = (unsigned char)*p;
-    if (!node->children[c]) return false;
-    node = node->children[c];
-  }
-  if (!node->is_token) return false;
-  node->freq = new_freq;
+bool trieUpdateScore(SubwordTrie* trie, const char* token, double new_score) {
+  if (!trie || !token) return false;
+  uint32_t node = trieLocate(trie, token);
+  if (node == TRIE_NONE || !trie->nodes[node].is_token) return false;
+  trie->nodes[node].score = new_score;
   return true;
 }
 
-static void trieCollectTokens(TrieNode* node, char* prefix, int depth, char*** tokens, int** freq, int* count, int* capacity) {
-  if (!node || depth >= MAX_TOKEN_LENGTH - 1) return;
+uint32_t trieTokenId(const SubwordTrie* trie, const char* token) {
+  if (!trie || !token) return TRIE_NONE;
+  uint32_t node = trieLocate(trie, token);
+  return (node != TRIE_NONE && trie->nodes[node].is_token) ? node : TRIE_NONE;
+}
+
+/**
+  @brief Every token that is a prefix of text[0..len), shortest first.
+  * one step down the trie per byte, stopping at the first byte with no edge, so
+    each byte is looked at once & nothing is copied or hashed.
+  * writes length, id & score of the matches into `matches`, which needs room for
+    min(len, MAX_TOKEN_LENGTH - 1) entries; returns the no of matches.
+ */
+int trieCommonPrefixSearch(const SubwordTrie* trie, const char* text, int len, TrieMatch* matches) {
+  if (!trie || !text || len <= 0) return 0;
+  if (len >= MAX_TOKEN_LENGTH) len = MAX_TOKEN_LENGTH - 1;
+  int count = 0;
+  uint32_t node = trie->root_children[(unsigned char)text[0]];
+  for (int i = 1; node != TRIE_NONE; i++) {
+    const TrieNode* n = &trie->nodes[node];
+    if (n->is_token) matches[count].score = n->score, matches[count].id = node, matches[count].len = i, count++;
+    if (i >= len) break;
+    unsigned char c = (unsigned char)text[i];
+    node = n->child;
+    while (node != TRIE_NONE && trie->nodes[node].label < c) node = trie->nodes[node].next;
+    if (node != TRIE_NONE && trie->nodes[node].label != c) node = TRIE_NONE;
+  }
+  return count;
+}
 
-  if (node->is_token) {
+static void trieCollectTokens(SubwordTrie* trie, uint32_t node, char* prefix, int depth, char*** tokens, int** freq, int* count, int* capacity) {
+  if (depth >= MAX_TOKEN_LENGTH) return;
+  const TrieNode* n = &trie->nodes[node];
+  if (n->is_token) {
     if (*count >= *capacity) {
       int new_capacity = (*capacity) * 2;
       char** new_tokens = (char**)realloc(*tokens, sizeof(char*) * new_capacity);
@@ -135,14 +250,12 @@ static void trieCollectTokens(TrieNode* node, char* prefix, int depth, char*** t
     prefix[depth] = '\0';
     (*tokens)[*count] = strdup(prefix);
     if (!(*tokens)[*count]) return;
-    (*freq)[*count] = node->freq;
+    (*freq)[*count] = n->freq;
     (*count)++;
   }
-  for (int i = 0; i < TRIE_CHILDREN; i++) {
-    if (node->children[i]) {
-      prefix[depth] = (char)i;
-      trieCollectTokens(node->children[i], prefix, depth + 1, tokens, freq, count, capacity);
-    }
+  for (uint32_t child = n->child; child != TRIE_NONE; child = trie->nodes[child].next) {
+    prefix[depth] = (char)trie->nodes[child].label;
+    trieCollectTokens(trie, child, prefix, depth + 1, tokens, freq, count, capacity);
   }
 }
 
@@ -154,7 +267,15 @@ void trieGetAllTokens(SubwordTrie* trie, char*** tokens, int** freq, int* count)
   *freq = (int*)malloc(capacity * sizeof(int));
   char prefix[MAX_TOKEN_LENGTH];
   memset(prefix, 0, MAX_TOKEN_LENGTH);
-  trieCollectTokens(trie->root, prefix, 0, tokens, freq, count, &capacity);
+  for (int c = 0; c < TRIE_CHILDREN; c++) {
+    if (trie->root_children[c] == TRIE_NONE) continue;
+    prefix[0] = (char)c;
+    trieCollectTokens(trie, trie->root_children[c], prefix, 1, tokens, freq, count, &capacity);
+  }
+}
+
+size_t trieMemoryUsage(const SubwordTrie* trie) {
+  return trie ? sizeof(SubwordTrie) + sizeof(TrieNode) * (size_t)trie->node_capacity : 0;
 }
 
 static void trieFreeTokens(char **tokens, int count) {
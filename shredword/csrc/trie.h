@@ -1,31 +1,58 @@
 #ifndef __TRIE__H__
 #define __TRIE__H__
 
+#include <stdint.h>
+#include <stddef.h>
+
 #define NUM_CHARS 256
 #define TRIE_CHILDREN 256
-#define MAX_TOKEN_LENGTH 16
+#define MAX_TOKEN_LENGTH 256  // same cap as the unigram MAX_TOKEN_LEN, so every vocab token fits
+#define TRIE_NONE UINT32_MAX
+#define TRIE_INITIAL_NODES 1024
 
+// nodes live in one array & link by index: `child` is the first child, children
+// are chained through `next` in ascending byte order (24 bytes a node instead of
+// 256 child pointers). removed nodes are chained on a free list for reuse.
+// `score` is the token's log-prob, read by the viterbi lattice walk.
 typedef struct TrieNode {
-  struct TrieNode* children[TRIE_CHILDREN];
-  bool is_token;
+  double score;
+  uint32_t child, next;
   int freq;
+  unsigned char label;
+  bool is_token;
 } TrieNode;
 
 typedef struct SubwordTrie {
-  TrieNode* root;
+  TrieNode* nodes;  // nodes[0] is the root
+  int node_count, node_capacity;
+  uint32_t free_list;
+  uint32_t root_children[TRIE_CHILDREN];  // direct first step, the root has the widest fan-out
   int total_tokens;
 } SubwordTrie;
 
+// a token found by trieCommonPrefixSearch. `id` is its node index: dense below
+// node_count & stable until the next insert or remove, so it can index arrays.
+typedef struct TrieMatch {
+  double score;
+  uint32_t id;
+  int len;
+} TrieMatch;
+
 extern "C" {
   SubwordTrie* trieCreate();
   void trieDestroy(SubwordTrie* trie);
   bool trieInsert(SubwordTrie* trie, const char* token, int freq);
+  bool trieBuild(SubwordTrie* trie, const char** tokens, const int* freqs, const double* scores, int count);  // tokens sorted by strcmp, into an empty trie
   int trieSearch(SubwordTrie* trie, const char* token);
   bool trieContains(SubwordTrie* trie, const char* token);
   int trieGetTokenCount(SubwordTrie* trie);
   bool trieRemove(SubwordTrie* trie, const char* token);
   bool trieUpdateFreq(SubwordTrie* trie, const char* token, int new_freq);
+  bool trieUpdateScore(SubwordTrie* trie, const char* token, double new_score);
+  uint32_t trieTokenId(const SubwordTrie* trie, const char* token);  // TRIE_NONE if not a token
+  int trieCommonPrefixSearch(const SubwordTrie* trie, const char* text, int len, TrieMatch* matches);
   void trieGetAllTokens(SubwordTrie* trie, char*** tokens, int** freq, int* count);
+  size_t trieMemoryUsage(const SubwordTrie* trie);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -151,15 +151,91 @@ ViterbiDecoder* viterbiDecoderCreate() {
   ViterbiDecoder* decoder = (ViterbiDecoder*)malloc(sizeof(ViterbiDecoder));
   if (!decoder) return NULL;
   decoder->cache = cacheCreate(VITERBI_CACHE_SIZE);
+  decoder->best = decoder->alpha = decoder->beta = NULL, decoder->edge = NULL, decoder->edge_begin = NULL, decoder->capacity = 0;
+  decoder->lattice = NULL, decoder->lattice_capacity = 0;
   return decoder;
 }
 
 void viterbiDecoderDestroy(ViterbiDecoder* decoder) {
   if (!decoder) return;
   if (decoder->cache) cacheFree(decoder->cache);
+  free(decoder->best); free(decoder->alpha); free(decoder->beta);
+  free(decoder->edge);
+  free(decoder->edge_begin);
+  free(decoder->lattice);
   free(decoder);
 }
 
+template <typename T>
+static bool growArray(T** array, int capacity) {
+  T* grown = (T*)realloc(*array, sizeof(T) * capacity);
+  if (!grown) return false;
+  *array = grown;
+  return true;
+}
+
+static bool viterbiReserve(ViterbiDecoder* decoder, int positions) {
+  if (positions <= decoder->capacity) return true;
+  int new_capacity = decoder->capacity > 0 ? decoder->capacity : 256;
+  while (new_capacity < positions) new_capacity *= 2;
+  if (!growArray(&decoder->best, new_capacity) || !growArray(&decoder->alpha, new_capacity) || !growArray(&decoder->beta, new_capacity) ||
+      !growArray(&decoder->edge, new_capacity) || !growArray(&decoder->edge_begin, new_capacity)) return false;
+  decoder->capacity = new_capacity;
+  return true;
+}
+
+static bool latticeReserve(ViterbiDecoder* decoder, int edges) {
+  if (edges <= decoder->lattice_capacity) return true;
+  int new_capacity = decoder->lattice_capacity > 0 ? decoder->lattice_capacity : 1024;
+  while (new_capacity < edges) new_capacity *= 2;
+  if (!growArray(&decoder->lattice, new_capacity)) return false;
+  decoder->lattice_capacity = new_capacity;
+  return true;
+}
+
+// log(sum(exp(x))) shifted by the max so nothing overflows; the second loop has no
+// dependency between iterations & vectorizes
+static inline double logSumExp(const double* x, int n) {
+  double max = -INFINITY;
+  for (int k = 0; k < n; k++) max = x[k] > max ? x[k] : max;
+  if (max == -INFINITY) return -INFINITY;
+  double sum = 0.0;
+  for (int k = 0; k < n; k++) sum += exp(x[k] - max);
+  return max + log(sum);
+}
+
+static inline double logAddExp(double a, double b) {
+  if (a < b) { double t = a; a = b; b = t; }
+  if (b == -INFINITY) return a;
+  return a + log1p(exp(b - a));
+}
+
+SpanList* spanListCreate(int initial_capacity) {
+  SpanList* list = (SpanList*)malloc(sizeof(SpanList));
+  if (!list) return NULL;
+  if (initial_capacity < 1) initial_capacity = 1;
+  list->spans = (TokenSpan*)malloc(sizeof(TokenSpan) * initial_capacity);
+  if (!list->spans) { free(list); return NULL; }
+  list->count = 0, list->capacity = initial_capacity;
+  return list;
+}
+
+void spanListDestroy(SpanList* list) {
+  if (!list) return;
+  free(list->spans);
+  free(list);
+}
+
+static bool spanListReserve(SpanList* list, int count) {
+  if (count <= list->capacity) return true;
+  int new_capacity = list->capacity * 2;
+  while (new_capacity < count) new_capacity *= 2;
+  TokenSpan* new_spans = (TokenSpan*)realloc(list->spans, sizeof(TokenSpan) * new_capacity);
+  if (!new_spans) return false;
+  list->spans = new_spans, list->capacity = new_capacity;
+  return true;
+}
+
 TokenList* tokenListCreate(int initial_capacity) {
   TokenList* list = (TokenList*)malloc(sizeof(TokenList));
   if (!list) return NULL;
@@ -190,63 +266,132 @@ void tokenListDestroy(TokenList* list) {
   free(list);
 }
 
-TokenList* viterbiDecode(ViterbiDecoder* decoder, const char* text, FastHashMap* vocab) {
-  if (!decoder || !text || !vocab) return NULL;
+/**
+  @brief Best segmentation of `text` under the vocab scores, written into `out` in text order.
+  * the lattice edges out of position i are the vocab tokens that prefix text + i,
+    found with one walk down the trie instead of hashing every substring.
+  * nothing is allocated once the decoder scratch & `out` are big enough for the text;
+    spans point into `text` by offset/length instead of copying the tokens.
+  * when no path covers the whole text, falls back to one span per byte.
+  * returns the no of spans, -1 on bad input, a text over MAX_TEXT_LEN or out of memory.
+ */
+int viterbiDecodeSpans(ViterbiDecoder* decoder, const char* text, const SubwordTrie* vocab, SpanList* out) {
+  if (!decoder || !text || !vocab || !out) return -1;
+  out->count = 0;
   int text_len = strlen(text);
-  if (text_len == 0) return tokenListCreate(1);
-  if (text_len >= MAX_TEXT_LEN) return NULL;
-  double* dp = (double*)calloc(text_len + 1, sizeof(double));
-  int* parent = (int*)malloc(sizeof(int) * (text_len + 1));
-  if (!dp || !parent) { free(dp); free(parent); return NULL; }
-  for (int i = 1; i <= text_len; i++) dp[i] = -1e9, parent[i] = -1;
-  dp[0] = 0.0;
+  if (text_len == 0) return 0;
+  if (text_len >= MAX_TEXT_LEN) return -1;
+  if (!viterbiReserve(decoder, text_len + 1)) return -1;
+  double* best = decoder->best;
+  TokenSpan* edge = decoder->edge;
+  for (int i = 1; i <= text_len; i++) best[i] = -1e9, edge[i].offset = -1;
+  best[0] = 0.0;
   for (int i = 0; i < text_len; i++) {
-    if (dp[i] < -1e8) continue;
-    int max_j = (i + 21 < text_len + 1) ? i + 21 : text_len + 1;
-    for (int j = i + 1; j < max_j; j++) {
-      int token_len = j - i;
-      if (token_len >= MAX_TOKEN_LEN) continue;
-      char token[MAX_TOKEN_LEN];
-      strncpy(token, text + i, token_len);
-      token[token_len] = '\0';
-      double* vocab_score = (double*)hashMapGet(vocab, token);
-      if (vocab_score) {
-        double score = dp[i] + *vocab_score;
-        if (score > dp[j]) { dp[j] = score; parent[j] = i; }
+    if (best[i] < -1e8) continue;
+    int matches = trieCommonPrefixSearch(vocab, text + i, text_len - i, decoder->matches);
+    for (int m = 0; m < matches; m++) {
+      const TrieMatch* match = &decoder->matches[m];
+      int j = i + match->len;
+      double score = best[i] + match->score;
+      if (score > best[j]) {
+        best[j] = score;
+        edge[j].offset = i, edge[j].length = match->len, edge[j].token_id = match->id, edge[j].score = match->score;
       }
     }
   }
-  if (parent[text_len] == -1) {
-    TokenList* result = tokenListCreate(text_len);
-    if (result) {
-      for (int i = 0; i < text_len; i++) {
-        char single[2] = {text[i], '\0'};
-        tokenListAdd(result, single);
-      }
+
+  if (edge[text_len].offset == -1) {
+    if (!spanListReserve(out, text_len)) return -1;
+    for (int i = 0; i < text_len; i++) {
+      TrieMatch match;
+      bool known = trieCommonPrefixSearch(vocab, text + i, 1, &match) == 1;
+      TokenSpan* span = &out->spans[i];
+      span->offset = i, span->length = 1;
+      span->token_id = known ? match.id : TRIE_NONE, span->score = known ? match.score : 0.0;
     }
-    free(dp); free(parent);
-    return result;
+    out->count = text_len;
+    return out->count;
   }
-  TokenList* path = tokenListCreate(text_len / 2 + 1);
-  int pos = text_len;
-  while (pos > 0 && parent[pos] != -1) {
-    int start = parent[pos];
-    int token_len = pos - start;
-    char token[MAX_TOKEN_LEN];
-    strncpy(token, text + start, token_len);
-    token[token_len] = '\0';
-    if (!tokenListAdd(path, token)) {
-      tokenListDestroy(path);
-      free(dp); free(parent);
-      return NULL;
+  int count = 0;
+  for (int pos = text_len; pos > 0; pos = edge[pos].offset) count++;
+  if (!spanListReserve(out, count)) return -1;
+  out->count = count;
+  for (int pos = text_len; pos > 0; pos = edge[pos].offset) out->spans[--count] = edge[pos];
+  return out->count;
+}
+
+/**
+  @brief Forward-backward over the same lattice as viterbiDecodeSpans.
+  * adds the expected no of occurrences of every vocab token in `text`, in units of
+    EXPECTED_COUNT_ONE, to counts[token_id]; `counts` needs a slot per trie node.
+  * alpha[i]: log-prob of all segmentations of text[0..i), beta[i]: of text[i..n),
+    an edge i -> j with score s has posterior exp(alpha[i] + s + beta[j] - alpha[n]).
+  * when no path covers the whole text every byte in the vocab counts once, the same
+    per-byte fallback as the viterbi decoder.
+  * returns the log marginal likelihood alpha[n], NAN on bad input, a text over
+    MAX_TEXT_LEN or out of memory; counts are only touched on success.
+ */
+double forwardBackward(ViterbiDecoder* decoder, const char* text, const SubwordTrie* vocab, int64_t* counts) {
+  if (!decoder || !text || !vocab || !counts) return NAN;
+  int text_len = strlen(text);
+  if (text_len == 0) return 0.0;
+  if (text_len >= MAX_TEXT_LEN) return NAN;
+  if (!viterbiReserve(decoder, text_len + 1)) return NAN;
+  double *alpha = decoder->alpha, *beta = decoder->beta;
+  int* edge_begin = decoder->edge_begin;
+  for (int i = 1; i <= text_len; i++) alpha[i] = -INFINITY;
+  alpha[0] = 0.0;
+  int edge_count = 0;
+  for (int i = 0; i < text_len; i++) {
+    edge_begin[i] = edge_count;
+    if (alpha[i] == -INFINITY) continue;
+    int matches = trieCommonPrefixSearch(vocab, text + i, text_len - i, decoder->matches);
+    if (!latticeReserve(decoder, edge_count + matches)) return NAN;
+    for (int m = 0; m < matches; m++) {
+      const TrieMatch* match = &decoder->matches[m];
+      alpha[i + match->len] = logAddExp(alpha[i + match->len], alpha[i] + match->score);
+      decoder->lattice[edge_count++] = *match;
     }
-    pos = start;
   }
-  for (int i = 0; i < path->count / 2; i++) {
-    char* temp = path->tokens[i];
-    path->tokens[i] = path->tokens[path->count - 1 - i];
-    path->tokens[path->count - 1 - i] = temp;
+  edge_begin[text_len] = edge_count;
+
+  double log_z = alpha[text_len];
+  if (log_z == -INFINITY) {
+    for (int i = 0; i < text_len; i++) {
+      TrieMatch match;
+      if (trieCommonPrefixSearch(vocab, text + i, 1, &match) == 1) counts[match.id] += (int64_t)EXPECTED_COUNT_ONE;
+    }
+    return log_z;
+  }
+  double terms[MAX_TOKEN_LENGTH];
+  const TrieMatch* lattice = decoder->lattice;
+  beta[text_len] = 0.0;
+  for (int i = text_len - 1; i >= 0; i--) {
+    int begin = edge_begin[i], n = edge_begin[i + 1] - begin;
+    for (int m = 0; m < n; m++) terms[m] = lattice[begin + m].score + beta[i + lattice[begin + m].len];
+    beta[i] = logSumExp(terms, n);
+  }
+  for (int i = 0; i < text_len; i++) {
+    if (alpha[i] == -INFINITY) continue;
+    for (int e = edge_begin[i]; e < edge_begin[i + 1]; e++) {
+      double posterior = exp(alpha[i] + lattice[e].score + beta[i + lattice[e].len] - log_z);
+      counts[lattice[e].id] += llround(posterior * EXPECTED_COUNT_ONE);
+    }
   }
-  free(dp); free(parent);
-  return path;
+  return log_z;
+}
+
+TokenList* viterbiDecode(ViterbiDecoder* decoder, const char* text, const SubwordTrie* vocab) {
+  SpanList* spans = spanListCreate(64);
+  if (!spans) return NULL;
+  int count = viterbiDecodeSpans(decoder, text, vocab, spans);
+  TokenList* list = count >= 0 ? tokenListCreate(count > 0 ? count : 1) : NULL;
+  for (int i = 0; list && i < count; i++) {
+    char token[MAX_TOKEN_LEN];
+    memcpy(token, text + spans->spans[i].offset, spans->spans[i].length);
+    token[spans->spans[i].length] = '\0';
+    if (!tokenListAdd(list, token)) { tokenListDestroy(list); list = NULL; }
+  }
+  spanListDestroy(spans);
+  return list;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <float.h>
 #include "cache.h"
 #include "hashmap.h"
+#include "../trie.h"
 
 #define MAX_TEXT_LEN 8192
 #define MAX_TOKEN_LEN 256
@@ -23,8 +24,36 @@ typedef struct SubwordExtractor {
   LRUCache* cache;
 } SubwordExtractor;
 
+// one token of a segmentation, as a slice of the decoded text. `token_id` is the
+// trie node id, TRIE_NONE for a char outside the vocab (no full path fallback).
+typedef struct TokenSpan {
+  int offset, length;
+  uint32_t token_id;
+  double score;
+} TokenSpan;
+
+// caller owned output of viterbiDecodeSpans, grows as needed & is meant to be reused
+typedef struct SpanList {
+  TokenSpan* spans;
+  int count, capacity;
+} SpanList;
+
+// expected counts are accumulated in fixed point, so adding them up in any order
+// (i.e. over any no of threads) gives the same totals
+#define EXPECTED_COUNT_ONE 4294967296.0  // 2^32 units per token occurrence
+
+// the lattice scratch (best score & best incoming edge per position, forward &
+// backward log-probs, the edges out of every position) is kept between calls &
+// only grows, so a decoder must not be shared between threads
 typedef struct ViterbiDecoder {
   LRUCache* cache;
+  double *best, *alpha, *beta;
+  TokenSpan* edge;
+  int* edge_begin;  // edges out of position i are lattice[edge_begin[i] .. edge_begin[i + 1])
+  int capacity;
+  TrieMatch* lattice;
+  int lattice_capacity;
+  TrieMatch matches[MAX_TOKEN_LENGTH];
 } ViterbiDecoder;
 
 typedef struct CharFreqResult {
@@ -50,8 +79,12 @@ extern "C" {
   // ViterbiDecoder functions  
   ViterbiDecoder* viterbiDecoderCreate();
   void viterbiDecoderDestroy(ViterbiDecoder* decoder);
-  TokenList* viterbiDecode(ViterbiDecoder* decoder, const char* text, FastHashMap* vocab);
+  TokenList* viterbiDecode(ViterbiDecoder* decoder, const char* text, const SubwordTrie* vocab);
+  int viterbiDecodeSpans(ViterbiDecoder* decoder, const char* text, const SubwordTrie* vocab, SpanList* out);
+  double forwardBackward(ViterbiDecoder* decoder, const char* text, const SubwordTrie* vocab, int64_t* counts);
   void tokenListDestroy(TokenList* list);
+  SpanList* spanListCreate(int initial_capacity);
+  void spanListDestroy(SpanList* list);
 
   // Utility functions
   bool subwordSetContains(SubwordSet* set, const char* subword);
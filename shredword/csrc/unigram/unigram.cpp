@@ -7,17 +7,21 @@
 #include <float.h>
 #include <stdint.h>
 #include "../inc/hash.h"
+#include "../inc/threads.h"
 #include "unigram.h"
 
-UnigramTrainer* trainerCreate(int vs, float cc, int msl, int sss) {
+UnigramTrainer* trainerCreate(int vs, float cc, int msl, int sss, int num_threads) {
   UnigramTrainer* trainer = (UnigramTrainer*)malloc(sizeof(UnigramTrainer));
   if (!trainer) return NULL;
   trainer->vocab_size = vs, trainer->character_coverage = cc, trainer->max_len = msl, trainer->seed_size = sss;
+  trainer->num_threads = resolve_threads(num_threads);
+  trainer->decoders = (ViterbiDecoder**)malloc(trainer->num_threads * sizeof(ViterbiDecoder*));
+  if (!trainer->decoders) { free(trainer); return NULL; }
+  for (int t = 0; t < trainer->num_threads; t++) trainer->decoders[t] = viterbiDecoderCreate();
   trainer->vocab_heap = heapCreate();
   trainer->token_freqs = hashmapCreate(INITIAL_SIZE);
   trainer->subword_trie = trieCreate();
   trainer->extractor = subwordExtractorCreate();
-  trainer->decoder = viterbiDecoderCreate();
   trainer->loss_cache = cacheCreate(100000);
   trainer->vocab = hashmapCreate(INITIAL_SIZE);
   trainer->final_vocab = hashmapCreate(INITIAL_SIZE);
@@ -34,7 +38,8 @@ void trainerDestroy(UnigramTrainer* trainer) {
   hashMapDestroy(trainer->token_freqs);
   trieDestroy(trainer->subword_trie);
   subwordExtractorDestroy(trainer->extractor);
-  viterbiDecoderDestroy(trainer->decoder);
+  for (int t = 0; t < trainer->num_threads; t++) viterbiDecoderDestroy(trainer->decoders[t]);
+  free(trainer->decoders);
   cacheFree(trainer->loss_cache);
   hashMapDestroy(trainer->vocab);
   hashMapDestroy(trainer->final_vocab);
@@ -147,6 +152,15 @@ bool preprocessTexts(UnigramTrainer* trainer) {
   return processed_count > 0;
 }
 
+typedef struct TokenFreq {
+  const char* token;
+  int freq;
+} TokenFreq;
+
+static int compareTokenFreqKeys(const void* a, const void* b) {
+  return strcmp(((const TokenFreq*)a)->token, ((const TokenFreq*)b)->token);
+}
+
 bool extractInitialSubwords(UnigramTrainer* trainer) {
   if (!trainer) return false;
   int sample_limit = 1000;
@@ -223,8 +237,10 @@ bool extractInitialSubwords(UnigramTrainer* trainer) {
   }
   printf("\n  Building initial vocabulary...\n");
   int added = 0;
+  int seed_capacity = hashMapSize(token_freq_map) < trainer->seed_size ? hashMapSize(token_freq_map) : trainer->seed_size;
+  TokenFreq* seeds = (TokenFreq*)malloc((seed_capacity > 0 ? seed_capacity : 1) * sizeof(TokenFreq));
   HashMapIterator* freq_iter = hashMapIteratorCreate(token_freq_map);
-  if (freq_iter) {
+  if (freq_iter && seeds) {
     const char* token; void* freq_value;
     while (hashMapIteratorNext(freq_iter, &token, &freq_value)) {
       int freq = *(int*)freq_value;
@@ -232,15 +248,27 @@ bool extractInitialSubwords(UnigramTrainer* trainer) {
         heapPush(trainer->vocab_heap, token, freq);
         double* log_freq = (double*)malloc(sizeof(double));
         if (log_freq) { *log_freq = log((double)freq); hashMapSet(trainer->vocab, token, log_freq); }
-        trieInsert(trainer->subword_trie, token, freq);
         int* freq_copy = (int*)malloc(sizeof(int));
         if (freq_copy) { *freq_copy = freq; hashMapSet(trainer->token_freqs, token, freq_copy); }
+        seeds[added].token = token, seeds[added].freq = freq;
         added++;
       }
     }
-    hashMapIteratorDestroy(freq_iter);
   }
-  printf("  Added %d tokens to initial vocabulary\n", added);
+  if (freq_iter) hashMapIteratorDestroy(freq_iter);
+  if (seeds) {
+    // sorted seeds go into the trie in one bulk build, the keys stay owned by token_freq_map
+    qsort(seeds, added, sizeof(TokenFreq), compareTokenFreqKeys);
+    const char** seed_tokens = (const char**)malloc((added > 0 ? added : 1) * sizeof(char*));
+    int* seed_freqs = (int*)malloc((added > 0 ? added : 1) * sizeof(int));
+    double* seed_scores = (double*)malloc((added > 0 ? added : 1) * sizeof(double));
+    if (seed_tokens && seed_freqs && seed_scores) {
+      for (int i = 0; i < added; i++) seed_tokens[i] = seeds[i].token, seed_freqs[i] = seeds[i].freq, seed_scores[i] = log((double)seeds[i].freq);
+      trieBuild(trainer->subword_trie, seed_tokens, seed_freqs, seed_scores, added);
+    }
+    free(seed_tokens); free(seed_freqs); free(seed_scores); free(seeds);
+  }
+  printf("  Added %d tokens to initial vocabulary (trie: %.1f MB)\n", added, trieMemoryUsage(trainer->subword_trie) / (1024.0 * 1024.0));
   HashMapIterator* cleanup_iter = hashMapIteratorCreate(token_freq_map);
   if (cleanup_iter) {
     const char* token; void* freq_value;
@@ -251,32 +279,82 @@ bool extractInitialSubwords(UnigramTrainer* trainer) {
   return added > 0;
 }
 
+/**
+  @brief Viterbi loss per char over `texts`, the texts are decoded across the trainer threads.
+  * each thread decodes a contiguous range into its own slot of `text_loss`; the cache
+    lookups & the sum then run in text order, so the result matches the serial loop.
+ */
+static double decodeTextLoss(ViterbiDecoder* decoder, const SubwordTrie* trie, const char* text, SpanList* spans) {
+  int span_count = viterbiDecodeSpans(decoder, text, trie, spans);
+  if (span_count < 0) return NAN;
+  double loss = 0.0;
+  for (int j = 0; j < span_count; j++) {
+    const TokenSpan* span = &spans->spans[j];
+    loss -= span->token_id != TRIE_NONE ? span->score : -UNKNOWN_TOKEN_SCORE;
+  }
+  return loss;
+}
+
 float computeLoss(UnigramTrainer* trainer, const char** texts, int text_count) {
   if (!trainer || !texts || text_count <= 0) return 0.0f;
+  double* text_loss = (double*)malloc(text_count * sizeof(double));
+  int* misses = (int*)malloc(text_count * sizeof(int));
+  bool* decoded = (bool*)calloc(text_count, sizeof(bool));
+  LRUCache* first_seen = cacheCreate((size_t)text_count);
+  if (!text_loss || !misses || !decoded || !first_seen) {
+    free(text_loss), free(misses), free(decoded);
+    if (first_seen) cacheFree(first_seen);
+    return 0.0f;
+  }
+
+  // pass 1: resolve cache hits serially, queue only the first text of each missing key
+  int miss_count = 0;
+  for (int i = 0; i < text_count; i++) {
+    if (!texts[i]) continue;
+    int key = (int)(stringHash64(texts[i]) % INT32_MAX);
+    if (cacheGet(trainer->loss_cache, key) != -1 || cacheGet(first_seen, key) != -1) continue;
+    cachePut(first_seen, key, i);
+    misses[miss_count++] = i;
+  }
+  cacheFree(first_seen);
+
+  // pass 2: decode the misses in parallel
+  int threads = threads_for((size_t)miss_count, trainer->num_threads, MIN_TEXTS_PER_THREAD);
+  parallel_for((size_t)miss_count, threads, [&](int t, size_t begin, size_t end) {
+    SpanList* spans = spanListCreate(256);
+    for (size_t m = begin; m < end; m++) {
+      int i = misses[m];
+      text_loss[i] = spans ? decodeTextLoss(trainer->decoders[t], trainer->subword_trie, texts[i], spans) : NAN;
+      decoded[i] = spans != NULL;
+    }
+    spanListDestroy(spans);
+  });
+
+  // pass 3: fill the cache & sum in text order, so the result matches the serial loop;
+  // a miss that wasn't queued (failed first decode, key collision, eviction) is decoded here
   double total_loss = 0.0;
   int total_len = 0;
+  SpanList* spans = NULL;
   for (int i = 0; i < text_count; i++) {
     if (!texts[i]) continue;
-    uint64_t cache_key = stringHash64(texts[i]);
-    int cached_loss = cacheGet(trainer->loss_cache, (int)(cache_key % INT32_MAX));
+    int key = (int)(stringHash64(texts[i]) % INT32_MAX);
+    int cached_loss = cacheGet(trainer->loss_cache, key);
     if (cached_loss != -1) {
       total_loss += (double)cached_loss / MAX_TEXTS_FOR_TOKEN_LOSS;
       total_len += (int)strlen(texts[i]);
       continue;
     }
-    TokenList* segmentation = viterbiDecode(trainer->decoder, texts[i], trainer->vocab);
-    if (!segmentation) continue;
-    double text_loss = 0.0;
-    for (int j = 0; j < segmentation->count; j++) {
-      double* token_score = (double*)hashMapGet(trainer->vocab, segmentation->tokens[j]);
-      double score = token_score ? *token_score : -UNKNOWN_TOKEN_SCORE;
-      text_loss -= score;
+    if (!decoded[i]) {
+      if (!spans) spans = spanListCreate(256);
+      text_loss[i] = spans ? decodeTextLoss(trainer->decoders[0], trainer->subword_trie, texts[i], spans) : NAN;
     }
-    cachePut(trainer->loss_cache, (int)(cache_key % INT32_MAX), (int)(text_loss * MAX_TEXTS_FOR_TOKEN_LOSS));
-    total_loss += text_loss;
+    if (isnan(text_loss[i])) continue;
+    cachePut(trainer->loss_cache, key, (int)(text_loss[i] * MAX_TEXTS_FOR_TOKEN_LOSS));
+    total_loss += text_loss[i];
     total_len += (int)strlen(texts[i]);
-    tokenListDestroy(segmentation);
   }
+  if (spans) spanListDestroy(spans);
+  free(text_loss), free(misses), free(decoded);
   return total_len > 0 ? (float)(total_loss / total_len) : 0.0f;
 }
 
@@ -373,42 +451,40 @@ bool pruneVocabStep(UnigramTrainer* trainer, const char** texts, int text_count,
 
 bool updateTokenScores(UnigramTrainer* trainer, const char** texts, int text_count) {
   if (!trainer || !texts || text_count <= 0) return false;
-  FastHashMap* token_context_freq = hashmapCreate(hashMapSize(trainer->vocab));
-  if (!token_context_freq) return false;
+  // expected counts from forward-backward, indexed by trie node id (the trie doesn't change until
+  // the scores are written back). every thread counts its range of texts into its own row, the
+  // rows are fixed point so summing them into row 0 gives the same totals for any no of threads.
+  int id_count = trainer->subword_trie->node_count;
   int text_limit = (text_count < 3000) ? text_count : 3000;
-  for (int i = 0; i < text_limit; i++) {
-    if (!texts[i]) continue;
-    TokenList* segmentation = viterbiDecode(trainer->decoder, texts[i], trainer->vocab);
-    if (!segmentation) continue;
-    for (int j = 0; j < segmentation->count; j++) {
-      if (hashMapContains(trainer->vocab, segmentation->tokens[j])) {
-        int* count = (int*)hashMapGet(token_context_freq, segmentation->tokens[j]);
-        if (count) { (*count)++; }
-        else {
-          int* new_count = (int*)malloc(sizeof(int));
-          if (new_count) { *new_count = 1; hashMapSet(token_context_freq, segmentation->tokens[j], new_count); }
-        }
-      }
+  int threads = threads_for((size_t)text_limit, trainer->num_threads, MIN_TEXTS_PER_THREAD);
+  int64_t* token_counts = (int64_t*)calloc((size_t)threads * id_count, sizeof(int64_t));
+  if (!token_counts) return false;
+  parallel_for((size_t)text_limit, threads, [&](int t, size_t begin, size_t end) {
+    int64_t* counts = token_counts + (size_t)t * id_count;
+    for (size_t i = begin; i < end; i++) {
+      if (texts[i]) forwardBackward(trainer->decoders[t], texts[i], trainer->subword_trie, counts);
     }
-    tokenListDestroy(segmentation);
-  }
-  int total_freq = 0;
-  HashMapIterator* freq_iter = hashMapIteratorCreate(token_context_freq);
-  if (freq_iter) {
-    const char* key; void* value;
-    while (hashMapIteratorNext(freq_iter, &key, &value)) total_freq += *(int*)value;
-    hashMapIteratorDestroy(freq_iter);
-  }
-  if (total_freq == 0) total_freq = 1;
+  });
+  for (int t = 1; t < threads; t++) {
+    const int64_t* counts = token_counts + (size_t)t * id_count;
+    for (int id = 0; id < id_count; id++) token_counts[id] += counts[id];
+  }
+  int64_t total_units = 0;
+  for (int id = 0; id < id_count; id++) total_units += token_counts[id];
+  double total_freq = total_units / EXPECTED_COUNT_ONE;
+  if (total_freq <= 0.0) total_freq = 1;
   HashMapIterator* vocab_iter = hashMapIteratorCreate(trainer->vocab);
   if (vocab_iter) {
     const char* key; void* value;
     while (hashMapIteratorNext(vocab_iter, &key, &value)) {
-      int* freq_ptr = (int*)hashMapGet(token_context_freq, key);
-      int freq = freq_ptr ? *freq_ptr : 1;
-      double new_score = log((double)freq) - log((double)total_freq);
+      uint32_t id = trieTokenId(trainer->subword_trie, key);
+      double expected = id != TRIE_NONE ? token_counts[id] / EXPECTED_COUNT_ONE : 0.0;
+      double count = expected > MIN_EXPECTED_COUNT ? expected : MIN_EXPECTED_COUNT;
+      int freq = expected > 1.0 ? (int)llround(expected) : 1;
+      double new_score = log(count) - log(total_freq);
       double* score_ptr = (double*)value;
       *score_ptr = new_score;
+      if (id != TRIE_NONE) trainer->subword_trie->nodes[id].score = new_score;
       if (hashMapContains(trainer->token_freqs, key)) {
         heapUpdateFreq(trainer->vocab_heap, key, freq);
         int* token_freq = (int*)hashMapGet(trainer->token_freqs, key);
@@ -417,13 +493,7 @@ bool updateTokenScores(UnigramTrainer* trainer, const char** texts, int text_cou
     }
     hashMapIteratorDestroy(vocab_iter);
   }
-  HashMapIterator* titer = hashMapIteratorCreate(token_context_freq);
-  if (titer) {
-    const char* key; void* value;
-    while (hashMapIteratorNext(titer, &key, &value)) free(value);
-    hashMapIteratorDestroy(titer);
-  }
-  hashMapDestroy(token_context_freq);
+  free(token_counts);
   return true;
 }
 
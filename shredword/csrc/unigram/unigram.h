@@ -20,17 +20,20 @@
 #define DEFAULT_REDUCTION_RATIO 0.8
 #define CONVERGENCE_THRESHOLD 0.001
 #define MIN_TOKEN_FREQ 1
+#define MIN_EXPECTED_COUNT 0.001  // floor for a token's expected count before taking its log
 #define UNKNOWN_TOKEN_SCORE -20.0
+#define MIN_TEXTS_PER_THREAD 64
 
 typedef struct UnigramTrainer {
   int vocab_size, seed_size, max_len, total_chars;
+  int num_threads;  // resolved E-step thread count, one decoder each
   float character_coverage;
 
   TokenFreqHeap* vocab_heap;
   FastHashMap *token_freqs, *vocab, *final_vocab;
   SubwordTrie* subword_trie;
   SubwordExtractor* extractor;
-  ViterbiDecoder* decoder;
+  ViterbiDecoder** decoders;
   LRUCache* loss_cache;
 
   char** texts;
@@ -48,7 +51,7 @@ typedef struct TokenScore {
 } TokenScore;
 
 extern "C" {
-  UnigramTrainer* trainerCreate(int vs, float cc, int msl, int sss);
+  UnigramTrainer* trainerCreate(int vs, float cc, int msl, int sss, int num_threads);
   void trainerDestroy(UnigramTrainer* trainer);
   bool addTextToTrainer(UnigramTrainer* trainer, const char* text);
 
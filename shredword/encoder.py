@@ -0,0 +1,52 @@
+import os, ctypes
+from .cbase import lib, BPEEncoderStats
+
+ENCODER_CACHE_WORDS = 1 << 16
+
+class BPEEncoder:
+  def __init__(self, model_path: str, num_threads: int = 0, cache_words: int = ENCODER_CACHE_WORDS):
+    if not os.path.exists(model_path): raise IOError(f"Model file does not exist: {model_path}")
+    self.encoder = lib.bpe_encoder_create(model_path.encode('utf-8'), num_threads, cache_words)
+    if not self.encoder: raise IOError(f"Failed to load BPE merges from {model_path}")
+    self.vocab_size = 256 + os.path.getsize(model_path) // 12
+
+  def encode(self, text) -> list:
+    data = text.encode('utf-8') if isinstance(text, str) else bytes(text)
+    out = (ctypes.c_int32 * max(len(data), 1))()
+    n = lib.bpe_encode(self.encoder, data, len(data), out)
+    return out[:n]
+
+  def encode_batch(self, texts) -> list:
+    datas = [t.encode('utf-8') if isinstance(t, str) else bytes(t) for t in texts]
+    n, total = len(datas), sum(len(d) for d in datas)
+    ptrs, lens = (ctypes.c_char_p * max(n, 1))(*datas), (ctypes.c_size_t * max(n, 1))(*[len(d) for d in datas])
+    out, offsets = (ctypes.c_int32 * max(total, 1))(), (ctypes.c_size_t * (n + 1))()
+    if lib.bpe_encode_batch(self.encoder, ptrs, lens, n, out, offsets) != 0: raise RuntimeError("Batch encoding failed")
+    flat = out[:offsets[n]]
+    return [flat[offsets[i]:offsets[i + 1]] for i in range(n)]
+
+  def decode_bytes(self, ids) -> bytes:
+    arr = (ctypes.c_int32 * max(len(ids), 1))(*ids)
+    size = lib.bpe_decode(self.encoder, arr, len(ids), None, 0)
+    if size < 0: raise ValueError("Invalid token id in input")
+    buf = ctypes.create_string_buffer(max(size, 1))
+    lib.bpe_decode(self.encoder, arr, len(ids), buf, size)
+    return buf.raw[:size]
+
+  def decode(self, ids) -> str: return self.decode_bytes(ids).decode('utf-8', errors='replace')
+
+  def stats(self) -> dict:
+    s = BPEEncoderStats()
+    lib.bpe_encoder_stats(self.encoder, ctypes.byref(s))
+    return {"cache_hits": int(s.cache_hits), "cache_misses": int(s.cache_misses)}
+
+  def destroy(self):
+    if getattr(self, "encoder", None):
+      try: lib.bpe_encoder_destroy(self.encoder)
+      finally: self.encoder = None
+
+  def __enter__(self): return self
+  def __exit__(self, exc_type, exc, tb): self.destroy()
+  def __del__(self):
+    try: self.destroy()
+    except Exception: pass
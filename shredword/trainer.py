@@ -3,8 +3,8 @@ from typing import Optional
 from .cbase import lib, BPEConfig
 
 class BPETrainer:
-  def __init__(self, vocab_size=8192, unk_id=0, character_coverage=0.995, min_pair_freq=2000):
-    self.config = BPEConfig(target_vocab_size=vocab_size, unk_id=unk_id, character_coverage=character_coverage, min_pair_freq=min_pair_freq)
+  def __init__(self, vocab_size=8192, unk_id=0, character_coverage=0.995, min_pair_freq=2000, num_threads=0, word_budget_mb=0, min_word_freq=0, multi_merge=False):
+    self.config = BPEConfig(target_vocab_size=vocab_size, unk_id=unk_id, character_coverage=character_coverage, min_pair_freq=min_pair_freq, num_threads=num_threads, word_budget=word_budget_mb << 20, min_word_freq=min_word_freq, multi_merge=int(multi_merge))
     self.trainer = lib.create_trainer(ctypes.byref(self.config))
     if not self.trainer: raise RuntimeError("Failed to create BPE trainer")
     self._load_corpus, self._train, self._save, self._destroy_fn = lib.bpe_load_corpus, lib.bpe_train, lib.bpe_save, lib.bpe_trainer_destroy
@@ -14,12 +14,46 @@ class BPETrainer:
     result = self._load_corpus(self.trainer, path.encode('utf-8'))
     if result != 0: raise IOError(f"Failed to load corpus from {path} (code {int(result)})")
 
+  def load_word_cache(self, path: str):
+    if not os.path.exists(path): raise IOError(f"Word cache does not exist: {path}")
+    result = lib.bpe_load_word_cache(self.trainer, path.encode('utf-8'))
+    if result != 0: raise IOError(f"Failed to load word cache from {path} (code {int(result)})")
+
+  @staticmethod
+  def build_word_cache(corpus_path: str, cache_path: str, num_threads: int = 0):
+    if not os.path.exists(corpus_path): raise IOError(f"Corpus file does not exist: {corpus_path}")
+    cache_dir = os.path.dirname(cache_path)
+    if cache_dir: os.makedirs(cache_dir, exist_ok=True)
+    if lib.bpe_build_word_cache(corpus_path.encode('utf-8'), cache_path.encode('utf-8'), num_threads) != 0: raise IOError(f"Failed to build word cache {cache_path}")
+
+  def load_model(self, path: str):
+    if not os.path.exists(path): raise IOError(f"Model file does not exist: {path}")
+    if lib.bpe_load_model(self.trainer, path.encode('utf-8')) != 0: raise IOError(f"Failed to load BPE merges from {path}")
+
   def train(self) -> int:
     merges = self._train(self.trainer)
     if merges < 0: raise RuntimeError("Training failed")
     print(f"Training completed: {int(merges)} merges performed.")
     return int(merges)
 
+  def set_checkpoint(self, path: str, every: int = 1000):
+    ckpt_dir = os.path.dirname(path)
+    if ckpt_dir: os.makedirs(ckpt_dir, exist_ok=True)
+    lib.bpe_set_checkpoint(self.trainer, path.encode('utf-8'), every)
+
+  def set_snapshots(self, sizes, prefix: str):
+    prefix_dir = os.path.dirname(prefix)
+    if prefix_dir: os.makedirs(prefix_dir, exist_ok=True)
+    arr = (ctypes.c_size_t * len(sizes))(*sizes)
+    if lib.bpe_set_snapshots(self.trainer, arr, len(sizes), prefix.encode('utf-8')) != 0: raise RuntimeError("Failed to set snapshot sizes")
+
+  def resume(self, path: str) -> int:
+    if not os.path.exists(path): raise IOError(f"Checkpoint file does not exist: {path}")
+    merges = lib.bpe_resume(self.trainer, path.encode('utf-8'))
+    if merges < 0: raise RuntimeError(f"Failed to resume from {path}")
+    print(f"Training completed: {int(merges)} merges performed after resuming.")
+    return int(merges)
+
   def save(self, model_path: str, vocab_path: str):
     model_dir, vocab_dir = os.path.dirname(model_path), os.path.dirname(vocab_path)
     if model_dir: os.makedirs(model_dir, exist_ok=True)
@@ -41,9 +75,9 @@ class BPETrainer:
 
 
 class UnigramTrainer:
-  def __init__(self, vocab_size=32000, character_coverage=0.9995, max_sentencepiece_length=16, seed_size=1000000):
+  def __init__(self, vocab_size=32000, character_coverage=0.9995, max_sentencepiece_length=16, seed_size=1000000, num_threads=0):
     self.vocab_size, self.character_coverage, self.max_len, self.seed_size = vocab_size, character_coverage, max_sentencepiece_length, seed_size
-    self.trainer = lib.trainerCreate(vocab_size, character_coverage, max_sentencepiece_length, seed_size)
+    self.trainer = lib.trainerCreate(vocab_size, character_coverage, max_sentencepiece_length, seed_size, num_threads)
     if not self.trainer: raise RuntimeError("Failed to create Unigram trainer")
     self.texts = []
 
@@ -0,0 +1,128 @@
+// benchmark: MaxHeap vs BucketQueue pair selection on a real corpus
+// Compilation: g++ -O2 -o bench bpe_bench.cpp ../shredword/csrc/bpe/bpe.cpp ../shredword/csrc/bpe/histogram.cpp ../shredword/csrc/bpe/hash.cpp ../shredword/csrc/bpe/heap.cpp ../shredword/csrc/bpe/index.cpp ../shredword/csrc/bpe/bucket.cpp -pthread
+// Usage: -> ./bench <corpus> [vocab_size=8000] [min_pair_freq=2] [threads=0] > /dev/null   (results go to stderr)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../shredword/csrc/bpe/bpe.h"
+#include "../shredword/csrc/bpe/heap.h"
+#include "../shredword/csrc/bpe/bucket.h"
+
+#define CHURN_PER_POP 8   // decrease-key updates replayed per popped pair
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct Seed {
+  PairKey key;
+  uint64_t freq;
+} Seed;
+
+/**
+ @brief Replay a selection workload on one engine: seed every counted pair, then pop the
+        max & lower CHURN_PER_POP other pairs (dropping them below `min_freq`) until empty.
+ * the churn sequence comes from a fixed LCG so both engines see the same updates.
+*/
+static double replay(const Seed* seeds, size_t n, uint64_t max_freq, uint64_t min_freq, bool buckets, size_t* pops) {
+  MaxHeap heap;
+  BucketQueue bq;
+  uint64_t* freq = (uint64_t*)malloc(n * sizeof(uint64_t));
+  heap_init(&heap, MIN_HEAP_SIZE);
+  if (buckets) bq_init(&bq, max_freq);
+  double t0 = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    freq[i] = seeds[i].freq;
+    if (buckets) bq_update(&bq, seeds[i].key, seeds[i].freq, (uint32_t)i);
+    else heap_update(&heap, seeds[i].key, seeds[i].freq, (uint32_t)i);
+  }
+  uint64_t lcg = 0x2545F4914F6CDD1DULL;
+  *pops = 0;
+  while (buckets ? !bq_empty(&bq) : !heap_empty(&heap)) {
+    BPEHeapEntry top = buckets ? bq_pop(&bq) : heap_pop(&heap);
+    freq[top.id] = 0;
+    (*pops)++;
+    for (int k = 0; k < CHURN_PER_POP; k++) {
+      lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+      uint32_t id = (uint32_t)((lcg >> 33) % n);
+      if (freq[id] == 0) continue;
+      freq[id] -= freq[id] / 4 + 1;
+      if (freq[id] >= min_freq) {
+        if (buckets) bq_update(&bq, seeds[id].key, freq[id], id);
+        else heap_update(&heap, seeds[id].key, freq[id], id);
+      } else {
+        freq[id] = 0;
+        if (buckets) bq_remove(&bq, id);
+        else heap_remove(&heap, id);
+      }
+    }
+  }
+  double dt = now_sec() - t0;
+  heap_free(&heap);
+  if (buckets) bq_free(&bq);
+  free(freq);
+  return dt;
+}
+
+static double train(Trainer* trainer, const char* corpus, int* n) {
+  if (bpe_load_corpus(trainer, corpus) != 0) exit(EXIT_FAILURE);
+  double t0 = now_sec();
+  *n = bpe_train(trainer);
+  return now_sec() - t0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <corpus> [vocab_size] [min_pair_freq] [threads]\n", argv[0]);
+    return 1;
+  }
+  BPEConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.target_vocab_size = argc > 2 ? (size_t)atol(argv[2]) : 8000;
+  cfg.unk_id = -1;
+  cfg.character_coverage = 0.995f;
+  cfg.min_pair_freq = argc > 3 ? (uint64_t)atoll(argv[3]) : 2;
+  cfg.num_threads = argc > 4 ? atoi(argv[4]) : 0;
+
+  // --- 1. end to end training with either engine ---
+  cfg.pair_queue = PAIR_QUEUE_HEAP;
+  Trainer* heap_trainer = create_trainer(&cfg);
+  cfg.pair_queue = PAIR_QUEUE_BUCKET;
+  Trainer* bucket_trainer = create_trainer(&cfg);
+  int hn, bn;
+  double heap_train = train(heap_trainer, argv[1], &hn);
+  double bucket_train = train(bucket_trainer, argv[1], &bn);
+  int same = 0;
+  while (same < hn && same < bn && heap_trainer->merge_ops[same].first == bucket_trainer->merge_ops[same].first
+         && heap_trainer->merge_ops[same].second == bucket_trainer->merge_ops[same].second) same++;
+  bpe_trainer_destroy(bucket_trainer);
+
+  // --- 2. selection structures alone, seeded with the pair counts left after training ---
+  BIMap* map = &heap_trainer->bigram_map;
+  Seed* seeds = (Seed*)malloc((map->size ? map->size : 1) * sizeof(Seed));
+  size_t n = 0;
+  uint64_t max_freq = 0;
+  for (size_t i = 0; i < map->cap; i++) {
+    if (map->slots[i].key == BIMAP_EMPTY || map->slots[i].info.freq < cfg.min_pair_freq) continue;
+    seeds[n].key = pair_unpack(map->slots[i].key);
+    seeds[n].freq = map->slots[i].info.freq;
+    if (seeds[n].freq > max_freq) max_freq = seeds[n].freq;
+    n++;
+  }
+  bpe_trainer_destroy(heap_trainer);
+  size_t heap_pops, bucket_pops;
+  double heap_t = replay(seeds, n, max_freq, cfg.min_pair_freq, false, &heap_pops);
+  double bucket_t = replay(seeds, n, max_freq, cfg.min_pair_freq, true, &bucket_pops);
+  free(seeds);
+
+  fprintf(stderr, "[BENCH]\t train heap   : %.3fs, %d merges\n", heap_train, hn);
+  fprintf(stderr, "[BENCH]\t train bucket : %.3fs, %d merges (first %d identical to heap)\n", bucket_train, bn, same);
+  fprintf(stderr, "[BENCH]\t replay of %zu live pairs (max freq %llu), %d decrease-keys per pop\n", n, (unsigned long long)max_freq, CHURN_PER_POP);
+  fprintf(stderr, "[BENCH]\t heap   : %.3fs (%zu pops)\n", heap_t, heap_pops);
+  fprintf(stderr, "[BENCH]\t bucket : %.3fs (%zu pops)\n", bucket_t, bucket_pops);
+  return 0;
+}
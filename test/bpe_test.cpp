@@ -1,5 +1,5 @@
 // test case for BPE trainer
-// Compilation: g++ -o run bpe_test.cpp ../shredword/csrc/bpe/bpe.cpp ../shredword/csrc/bpe/histogram.cpp ../shredword/csrc/bpe/hash.cpp ../shredword/csrc/bpe/heap.cpp
+// Compilation: g++ -o run bpe_test.cpp ../shredword/csrc/bpe/bpe.cpp ../shredword/csrc/bpe/encoder.cpp ../shredword/csrc/bpe/histogram.cpp ../shredword/csrc/bpe/hash.cpp ../shredword/csrc/bpe/heap.cpp ../shredword/csrc/bpe/index.cpp ../shredword/csrc/bpe/bucket.cpp -pthread
 // Usage: -> ./run
 
 #include <stdio.h>
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <unistd.h>
 #include "../shredword/csrc/bpe/bpe.h"
+#include "../shredword/csrc/bpe/encoder.h"
 #include "../shredword/csrc/bpe/hash.h"
 #include "../shredword/csrc/bpe/heap.h"
 #include "../shredword/csrc/bpe/histogram.h"
@@ -55,6 +56,40 @@ static int create_test_corpus(const char* filename) {
   return 1;
 }
 
+// byte-for-byte comparison of two files
+static int files_equal(const char* a, const char* b) {
+  FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+  int same = fa && fb;
+  while (same) {
+    int ca = fgetc(fa), cb = fgetc(fb);
+    if (ca != cb) same = 0;
+    if (ca == EOF || cb == EOF) break;
+  }
+  if (fa) fclose(fa);
+  if (fb) fclose(fb);
+  return same;
+}
+
+// copy `src` to `dst` with `n` bytes at `offset` overwritten & the last `drop` bytes cut off
+static int patch_copy(const char* src, const char* dst, long offset, const void* bytes, size_t n, long drop) {
+  FILE* f = fopen(src, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char* buf = (char*)malloc(size);
+  int ok = buf && fread(buf, 1, size, f) == (size_t)size && offset + (long)n <= size && drop <= size;
+  fclose(f);
+  if (ok) {
+    memcpy(buf + offset, bytes, n);
+    FILE* out = fopen(dst, "wb");
+    ok = out && fwrite(buf, 1, size - drop, out) == (size_t)(size - drop);
+    if (out) fclose(out);
+  }
+  free(buf);
+  return ok;
+}
+
 // Test 1: Basic trainer creation and destruction
 static int test_trainer_creation() {
   BPEConfig config = {
@@ -110,7 +145,8 @@ static int test_corpus_loading() {
   
   TEST_ASSERT(result == 0, "Corpus loading failed");
   TEST_ASSERT(trainer->corpus.vocab_size > 0, "No words loaded from corpus");
-  TEST_ASSERT(trainer->corpus.words != NULL, "Words array not allocated");
+  TEST_ASSERT(trainer->corpus.tokens != NULL, "Token array not allocated");
+  TEST_ASSERT(trainer->corpus.offsets != NULL, "Word offsets not allocated");
   TEST_ASSERT(trainer->corpus.word_counts != NULL, "Word counts array not allocated");
   
   printf("[DEBUG] Loaded %zu unique words from test corpus\n", trainer->corpus.vocab_size);
@@ -118,7 +154,7 @@ static int test_corpus_loading() {
   // Verify some words were loaded correctly
   int found_words = 0;
   for (size_t i = 0; i < trainer->corpus.vocab_size && i < 10; i++) {
-    if (trainer->corpus.words[i] != NULL && trainer->corpus.word_counts[i] > 0) {
+    if (trainer->corpus.lengths[i] > 0 && trainer->corpus.word_counts[i] > 0) {
       found_words++;
     }
   }
@@ -156,8 +192,8 @@ static int test_bigram_counting() {
   
   // Verify heap ordering (max heap property)
   if (trainer->heap.size >= 2) {
-    HeapEntry top = trainer->heap.data[0];
-    HeapEntry second = trainer->heap.data[1];
+    BPEHeapEntry top = trainer->heap.data[0];
+    BPEHeapEntry second = trainer->heap.data[1];
     TEST_ASSERT(top.freq >= second.freq, "Heap ordering violated");
   }
   
@@ -297,7 +333,620 @@ static int test_model_saving() {
   TEST_PASS("test_model_saving");
 }
 
-// Test 8: Error handling
+// Test 8: Incremental pair counts stay exact on overlapping runs
+static int test_incremental_counts() {
+  const char* test_file = "test_overlap.txt";
+  FILE* fp = fopen(test_file, "w");
+  TEST_ASSERT(fp != NULL, "Failed to create overlap corpus");
+  for (int i = 0; i < 30; i++) {
+    fprintf(fp, "aaa aaaa aaaaa abab ababab baab aabaa\n");
+  }
+  fprintf(fp, "z\n");
+  fclose(fp);
+
+  BPEConfig config = {
+    .target_vocab_size = 270,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 1   // recount every merged pair
+  };
+
+  Trainer* trainer = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(trainer, test_file) == 0, "Corpus loading failed");
+
+  int total_merges = bpe_train(trainer);
+  TEST_ASSERT(total_merges > 0, "No merges performed during training");
+  TEST_ASSERT(trainer->verify_mismatches == 0, "Incremental counts disagree with recount");
+
+  bpe_trainer_destroy(trainer);
+  unlink(test_file);
+  TEST_PASS("test_incremental_counts");
+}
+
+// Test 9: Indexed heap keeps one entry per pair & re-keys it in place
+static int test_indexed_heap() {
+  MaxHeap heap;
+  heap_init(&heap, 2);
+  for (uint32_t id = 0; id < 8; id++) {
+    PairKey key = {(int32_t)id, (int32_t)id + 1};
+    heap_update(&heap, key, 10 + id, id);
+  }
+  PairKey k3 = {3, 4}, k7 = {7, 8};
+  heap_update(&heap, k3, 100, 3);   // increase-key
+  heap_update(&heap, k7, 1, 7);     // decrease-key
+  heap_remove(&heap, 5);
+  heap_remove(&heap, 5);            // removing twice is a no-op
+  TEST_ASSERT(heap.size == 7, "Heap should hold exactly one entry per live pair");
+
+  uint64_t expected[] = {100, 16, 14, 12, 11, 10, 1};
+  for (size_t i = 0; i < 7; i++) {
+    BPEHeapEntry top = heap_pop(&heap);
+    TEST_ASSERT(top.freq == expected[i], "Heap popped entries out of order");
+    TEST_ASSERT(heap.pos[top.id] == HEAP_NPOS, "Popped pair still has a heap position");
+  }
+  TEST_ASSERT(heap_empty(&heap), "Heap should be empty");
+  heap_free(&heap);
+  TEST_PASS("test_indexed_heap");
+}
+
+// Test 10: Bucket queue engine always pops the current max & keeps counts exact
+static int test_bucket_queue() {
+  const char* test_file = "test_bucket.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 1,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_BUCKET
+  };
+
+  Trainer* trainer = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(trainer, test_file) == 0, "Corpus loading failed");
+  bpe_init(trainer);
+  uint64_t last = UINT64_MAX;
+  while (!bq_empty(&trainer->buckets) && trainer->num_merges < 40) {
+    uint64_t top = bq_top_freq(&trainer->buckets);
+    TEST_ASSERT(top <= last, "Max pair frequency increased between merges");
+    TEST_ASSERT(bpe_merge_batch(trainer, 1) == 1, "Merge failed");
+    last = top;
+  }
+  TEST_ASSERT(trainer->num_merges > 0, "No merges performed");
+  TEST_ASSERT(trainer->verify_mismatches == 0, "Incremental counts disagree with recount");
+
+  bpe_trainer_destroy(trainer);
+  unlink(test_file);
+  TEST_PASS("test_bucket_queue");
+}
+
+// Test 11: Arena reuses its blocks across resets & training reports the counters
+static int test_arena() {
+  Arena a;
+  arena_init(&a, 256);
+  uint64_t first_round_blocks = 0;
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 100; i++) {
+      uint64_t* p = (uint64_t*)arena_alloc(&a, sizeof(uint64_t) * 3);
+      TEST_ASSERT(((uintptr_t)p % ARENA_ALIGN) == 0, "Arena allocation misaligned");
+      p[0] = p[1] = p[2] = i;
+    }
+    if (round == 0) first_round_blocks = a.blocks;
+    arena_reset(&a);
+  }
+  TEST_ASSERT(a.allocs == 300, "Arena allocation count wrong");
+  TEST_ASSERT(a.blocks == first_round_blocks, "Arena blocks were not reused after reset");
+  arena_free(&a);
+
+  const char* test_file = "test_arena.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 280,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+  Trainer* trainer = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(trainer, test_file) == 0, "Corpus loading failed");
+  int merges = bpe_train(trainer);
+  BPEAllocStats stats;
+  bpe_alloc_stats(trainer, &stats);
+  TEST_ASSERT(stats.delta_resets == (uint64_t)merges, "Delta arena should be reset once per merge");
+  TEST_ASSERT(stats.delta_allocs > stats.delta_blocks, "Delta nodes were not pooled");
+  TEST_ASSERT(stats.index_allocs > 0, "Pair index nodes not counted");
+
+  bpe_trainer_destroy(trainer);
+  unlink(test_file);
+  TEST_PASS("test_arena");
+}
+
+// Test 12: A run resumed from a checkpoint produces the same merges as an uninterrupted one
+static int test_checkpoint_resume() {
+  const char* test_file = "test_ckpt.txt";
+  const char* ckpt = "test_ckpt.bin";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+
+  Trainer* full = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(full, test_file) == 0, "Corpus loading failed");
+  int full_merges = bpe_train(full);
+  TEST_ASSERT(full_merges > 20, "Too few merges to test resuming");
+
+  config.target_vocab_size = INITIAL_VOCAB_SIZE + 20;
+  Trainer* first = create_trainer(&config);
+  bpe_set_checkpoint(first, ckpt, 10);
+  TEST_ASSERT(bpe_load_corpus(first, test_file) == 0, "Corpus loading failed");
+  TEST_ASSERT(bpe_train(first) == 20, "Interrupted run should stop at 20 merges");
+  bpe_trainer_destroy(first);
+
+  config.target_vocab_size = 300;
+  Trainer* resumed = create_trainer(&config);
+  int rest = bpe_resume(resumed, ckpt);
+  TEST_ASSERT(rest == full_merges - 20, "Resumed run did the wrong number of merges");
+  for (size_t m = 0; m < full->num_merges; m++) {
+    TEST_ASSERT(full->merge_ops[m].first == resumed->merge_ops[m].first && full->merge_ops[m].second == resumed->merge_ops[m].second, "Resumed merges differ");
+  }
+  TEST_ASSERT(bpe_resume(resumed, test_file) == -1, "Non-checkpoint file should be rejected");
+
+  // corrupt files must be rejected, not indexed or allocated from: header is 48 bytes
+  // (magic, version, then num_merges, vocab_size, num_tokens, num_pairs), then merge_ops,
+  // lengths, word_counts, tokens & pairs
+  const char* bad = "test_ckpt_bad.bin";
+  uint64_t counts[3];   // num_merges, vocab_size, num_tokens
+  FILE* cf = fopen(ckpt, "rb");
+  TEST_ASSERT(cf && fseek(cf, 8, SEEK_SET) == 0 && fread(counts, sizeof(uint64_t), 3, cf) == 3, "Failed to read checkpoint header");
+  fclose(cf);
+  long merges_at = 48, tokens_at = merges_at + 8 * (long)counts[0] + 12 * (long)counts[1];
+  long pairs_at = tokens_at + 4 * (long)counts[2];
+  int32_t future_id = INITIAL_VOCAB_SIZE + 5;   // merge #5 is the first that may use it
+  int32_t huge_id = INITIAL_VOCAB_SIZE + (int32_t)counts[0] + 100;
+  int32_t stray_negative = -7;
+  uint64_t bad_pair = ((uint64_t)(uint32_t)huge_id << 32) | 97;
+  uint64_t huge_count = (uint64_t)1 << 61;   // would overflow the buffer sizes if trusted
+  struct { long offset; const void* bytes; size_t n; long drop; const char* what; } cases[] = {
+    {merges_at + 8 * 2, &future_id, 4, 0, "Merge using a later id should be rejected"},
+    {tokens_at, &huge_id, 4, 0, "Token id past the vocab should be rejected"},
+    {tokens_at + 4, &stray_negative, 4, 0, "Negative token other than unk_id should be rejected"},
+    {pairs_at, &bad_pair, 8, 0, "Pair key past the vocab should be rejected"},
+    {8, &huge_count, 8, 0, "Huge num_merges should be rejected"},
+    {16, &huge_count, 8, 0, "Huge vocab_size should be rejected"},
+    {24, &huge_count, 8, 0, "Huge num_tokens should be rejected"},
+    {0, &huge_count, 0, 4, "Truncated checkpoint should be rejected"},
+  };
+  // a failed resume leaves the trainer as it was, so it can still train its own corpus
+  Trainer* kept = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(kept, test_file) == 0, "Corpus loading failed");
+  size_t kept_words = kept->corpus.vocab_size, kept_tokens = kept->corpus.offsets[kept_words];
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    TEST_ASSERT(patch_copy(ckpt, bad, cases[c].offset, cases[c].bytes, cases[c].n, cases[c].drop), "Failed to write corrupt checkpoint");
+    TEST_ASSERT(bpe_resume(kept, bad) == -1, cases[c].what);
+    TEST_ASSERT(kept->num_merges == 0 && kept->corpus.vocab_size == kept_words, "Failed resume should keep the trainer's corpus");
+    TEST_ASSERT(kept->corpus.offsets[kept_words] == kept_tokens, "Failed resume should keep the trainer's tokens");
+  }
+  TEST_ASSERT(bpe_train(kept) == full_merges, "Trainer should still train after a failed resume");
+  for (size_t m = 0; m < full->num_merges; m++) {
+    TEST_ASSERT(full->merge_ops[m].first == kept->merge_ops[m].first && full->merge_ops[m].second == kept->merge_ops[m].second, "Merges after a failed resume differ");
+  }
+  bpe_trainer_destroy(kept);
+
+  bpe_trainer_destroy(full);
+  bpe_trainer_destroy(resumed);
+  unlink(test_file);
+  unlink(ckpt);
+  unlink(bad);
+  TEST_PASS("test_checkpoint_resume");
+}
+
+// Test 13: A corpus loaded from the word cache matches the one parsed from text
+static int test_word_cache() {
+  const char* test_file = "test_words.txt";
+  const char* cache = "test_words.cache";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  TEST_ASSERT(bpe_build_word_cache(test_file, cache, 1) == 0, "Word cache build failed");
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+  Trainer* text = create_trainer(&config);
+  Trainer* cached = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(text, test_file) == 0, "Corpus loading failed");
+  TEST_ASSERT(bpe_load_word_cache(cached, cache) == 0, "Word cache loading failed");
+  const Corpus *a = &text->corpus, *b = &cached->corpus;
+  TEST_ASSERT(a->vocab_size == b->vocab_size, "Word count differs");
+  TEST_ASSERT(a->offsets[a->vocab_size] == b->offsets[b->vocab_size], "Token count differs");
+  TEST_ASSERT(memcmp(a->tokens, b->tokens, a->offsets[a->vocab_size] * sizeof(int32_t)) == 0, "Tokens differ");
+  TEST_ASSERT(memcmp(a->word_counts, b->word_counts, a->vocab_size * sizeof(uint64_t)) == 0, "Word counts differ");
+  TEST_ASSERT(bpe_load_word_cache(cached, test_file) == -1, "Text file should be rejected as a cache");
+
+  // min_word_freq drops the same rare words whether the corpus comes from text or the cache
+  config.min_word_freq = 5;
+  Trainer* text_min = create_trainer(&config);
+  Trainer* cached_min = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(text_min, test_file) == 0, "Corpus loading failed");
+  TEST_ASSERT(bpe_load_word_cache(cached_min, cache) == 0, "Word cache loading failed");
+  const Corpus *c = &text_min->corpus, *d = &cached_min->corpus;
+  TEST_ASSERT(d->vocab_size > 0 && d->vocab_size < b->vocab_size, "min_word_freq should shrink the cached corpus");
+  TEST_ASSERT(c->vocab_size == d->vocab_size, "Text & cache should keep the same no of words");
+  TEST_ASSERT(c->offsets[c->vocab_size] == d->offsets[d->vocab_size], "Text & cache should keep the same tokens");
+  uint64_t text_total = 0, cached_total = 0;
+  for (size_t i = 0; i < d->vocab_size; i++) {
+    TEST_ASSERT(d->word_counts[i] >= 5, "Cached corpus kept a word below min_word_freq");
+    text_total += c->word_counts[i], cached_total += d->word_counts[i];
+  }
+  TEST_ASSERT(text_total == cached_total, "Text & cache should keep the same word counts");
+
+  bpe_trainer_destroy(text_min);
+  bpe_trainer_destroy(cached_min);
+  bpe_trainer_destroy(text);
+  bpe_trainer_destroy(cached);
+  unlink(test_file);
+  unlink(cache);
+  TEST_PASS("test_word_cache");
+}
+
+// Test 14: A snapshot taken on the way matches a separate run to that size
+static int test_snapshots() {
+  const char* test_file = "test_snap.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 280,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+  Trainer* small = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(small, test_file) == 0, "Corpus loading failed");
+  bpe_train(small);
+  bpe_save(small, "test_ref.bin", "test_ref.vocab");
+
+  config.target_vocab_size = 300;
+  Trainer* big = create_trainer(&config);
+  size_t sizes[] = {280};
+  TEST_ASSERT(bpe_set_snapshots(big, sizes, 1, "test_snap") == 0, "Setting snapshots failed");
+  TEST_ASSERT(bpe_load_corpus(big, test_file) == 0, "Corpus loading failed");
+  bpe_train(big);
+  TEST_ASSERT(files_equal("test_ref.bin", "test_snap_280.bin"), "Snapshot merges differ from a separate run");
+  TEST_ASSERT(files_equal("test_ref.vocab", "test_snap_280.vocab"), "Snapshot vocab differs from a separate run");
+
+  bpe_trainer_destroy(small);
+  bpe_trainer_destroy(big);
+  unlink(test_file);
+  unlink("test_ref.bin"), unlink("test_ref.vocab");
+  unlink("test_snap_280.bin"), unlink("test_snap_280.vocab");
+  TEST_PASS("test_snapshots");
+}
+
+// Test 15: Extending a saved model gives the same merges as training to the larger size directly
+static int test_load_model() {
+  const char* test_file = "test_extend.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 280,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+  Trainer* small = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(small, test_file) == 0, "Corpus loading failed");
+  bpe_train(small);
+  bpe_save(small, "test_small.bin", "test_small.vocab");
+
+  config.target_vocab_size = 300;
+  Trainer* full = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(full, test_file) == 0, "Corpus loading failed");
+  bpe_train(full);
+  bpe_save(full, "test_full.bin", "test_full.vocab");
+
+  Trainer* ext = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(ext, test_file) == 0, "Corpus loading failed");
+  TEST_ASSERT(bpe_load_model(ext, "test_small.bin") == 0, "Model loading failed");
+  TEST_ASSERT(ext->num_merges == small->num_merges, "Loaded merge count wrong");
+  TEST_ASSERT(bpe_train(ext) == (int)(full->num_merges - small->num_merges), "Extension did the wrong number of merges");
+  bpe_save(ext, "test_ext.bin", "test_ext.vocab");
+  TEST_ASSERT(files_equal("test_full.bin", "test_ext.bin"), "Extended merges differ from a direct run");
+  TEST_ASSERT(files_equal("test_full.vocab", "test_ext.vocab"), "Extended vocab differs from a direct run");
+  TEST_ASSERT(bpe_load_model(ext, "test_small.vocab") == -1, "Vocab file should be rejected as a model");
+
+  bpe_trainer_destroy(small);
+  bpe_trainer_destroy(full);
+  bpe_trainer_destroy(ext);
+  unlink(test_file);
+  unlink("test_small.bin"), unlink("test_small.vocab");
+  unlink("test_full.bin"), unlink("test_full.vocab");
+  unlink("test_ext.bin"), unlink("test_ext.vocab");
+  TEST_PASS("test_load_model");
+}
+
+// Test 16: Encoder reproduces the trained segmentation of every word & decodes back to the text
+static int test_encoder() {
+  const char* test_file = "test_encode.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+  Trainer* trainer = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(trainer, test_file) == 0, "Corpus loading failed");
+  bpe_train(trainer);
+  bpe_save(trainer, "test_enc.bin", "test_enc.vocab");
+  BPEEncoder* enc = bpe_encoder_create("test_enc.bin", 2, 16);
+  TEST_ASSERT(enc != NULL, "Encoder creation failed");
+  TEST_ASSERT(enc->vocab_size == INITIAL_VOCAB_SIZE + trainer->num_merges, "Encoder vocab size wrong");
+
+  char word[256];
+  int32_t ids[256];
+  for (size_t w = 0; w < trainer->corpus.vocab_size; w++) {
+    const int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[w];
+    uint32_t len = trainer->corpus.lengths[w];
+    bool unk = false;
+    for (uint32_t i = 0; i < len; i++) unk = unk || toks[i] == config.unk_id;
+    if (unk) continue;  // dropped by character_coverage, the encoder always sees raw bytes
+    int64_t n = bpe_decode(enc, toks, len, word, sizeof(word));
+    TEST_ASSERT(n > 0 && n < (int64_t)sizeof(word), "Decoding a trained word failed");
+    TEST_ASSERT(bpe_encode(enc, word, (size_t)n, ids) == len, "Encoded length differs from training");
+    TEST_ASSERT(memcmp(ids, toks, len * sizeof(int32_t)) == 0, "Encoded ids differ from training");
+  }
+
+  const char* texts[3] = {"the quick brown fox\n", "", "lazy  dogs jump over the the the"};
+  size_t lens[3] = {strlen(texts[0]), 0, strlen(texts[2])}, offsets[4];
+  int32_t out[64];
+  TEST_ASSERT(bpe_encode_batch(enc, texts, lens, 3, out, offsets) == 0, "Batch encoding failed");
+  TEST_ASSERT(offsets[1] == offsets[2], "Empty text should give no ids");
+  for (int i = 0; i < 3; i++) {
+    size_t n = bpe_encode(enc, texts[i], lens[i], ids);
+    TEST_ASSERT(n == offsets[i + 1] - offsets[i] && memcmp(ids, out + offsets[i], n * sizeof(int32_t)) == 0, "Batch differs from single encode");
+    TEST_ASSERT(bpe_decode(enc, ids, n, word, sizeof(word)) == (int64_t)lens[i] && memcmp(word, texts[i], lens[i]) == 0, "Round trip lost bytes");
+  }
+  BPEEncoderStats stats;
+  bpe_encoder_stats(enc, &stats);
+  TEST_ASSERT(stats.cache_hits > 0 && stats.cache_misses > 0, "Word cache was not used");
+  int32_t bad = (int32_t)enc->vocab_size;
+  TEST_ASSERT(bpe_decode(enc, &bad, 1, word, sizeof(word)) == -1, "Unknown id should be rejected");
+  TEST_ASSERT(bpe_encoder_create("test_enc.vocab", 1, 0) == NULL, "Vocab file should be rejected as a model");
+
+  bpe_encoder_destroy(enc);
+  bpe_trainer_destroy(trainer);
+  unlink(test_file);
+  unlink("test_enc.bin"), unlink("test_enc.vocab");
+  TEST_PASS("test_encoder");
+}
+
+// Test 17: Pruning drops rare words & gives their memory back
+static int test_word_pruning() {
+  StrMap map;
+  strmap_init(&map, 16);
+  char key[32];
+  for (int i = 0; i < 20000; i++) {
+    snprintf(key, sizeof(key), "noise%d", i);
+    strmap_increment(&map, key);
+  }
+  strmap_add(&map, "frequent", 50);
+  strmap_add(&map, "common", 3);
+  size_t before = strmap_bytes(&map);
+  TEST_ASSERT(strmap_prune(&map, 2) == 20000, "Wrong no of pruned keys");
+  TEST_ASSERT(map.size == 2 && map.cap < 64 && strmap_bytes(&map) < before, "Pruned map did not shrink");
+  uint64_t total = 0;
+  strmap_iter(&map, [](const char*, uint64_t v, void* u) { *(uint64_t*)u += v; }, &total);
+  TEST_ASSERT(total == 53, "Surviving counts changed");
+  strmap_free(&map);
+
+  const char* test_file = "test_prune.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 0,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP,
+    .word_budget = 0,
+    .min_word_freq = 0
+  };
+  Trainer* all = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(all, test_file) == 0, "Corpus loading failed");
+  config.min_word_freq = 2;
+  Trainer* pruned = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(pruned, test_file) == 0, "Corpus loading failed");
+  TEST_ASSERT(pruned->corpus.vocab_size > 0 && pruned->corpus.vocab_size < all->corpus.vocab_size, "min_word_freq kept the wrong words");
+  for (size_t w = 0; w < pruned->corpus.vocab_size; w++) TEST_ASSERT(pruned->corpus.word_counts[w] >= 2, "Rare word survived");
+  bpe_trainer_destroy(all);
+  bpe_trainer_destroy(pruned);
+  unlink(test_file);
+  TEST_PASS("test_word_pruning");
+}
+
+// Test 18: Words left out of the active list can never be merged again
+static int test_active_words() {
+  const char* test_file = "test_active.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 3,
+    .verify_every = 1,
+    .num_threads = 1,
+    .pair_queue = PAIR_QUEUE_HEAP
+  };
+  Trainer* trainer = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(trainer, test_file) == 0, "Corpus loading failed");
+  bpe_init(trainer);
+  TEST_ASSERT(trainer->num_active > 0 && trainer->num_active < trainer->corpus.vocab_size, "Initial active list should skip dead words");
+  bpe_merge_batch(trainer, 20);
+  trainer->active_merges = trainer->num_merges - ACTIVE_COMPACT_EVERY;   // force a compaction on the next batch
+  bpe_merge_batch(trainer, 1);
+  TEST_ASSERT(trainer->active_merges == trainer->num_merges, "Active list was not compacted");
+  size_t ai = 0;
+  for (size_t w = 0; w < trainer->corpus.vocab_size; w++) {
+    if (ai < trainer->num_active && trainer->active_words[ai] == w) {
+      ai++;
+      continue;
+    }
+    const int32_t* toks = trainer->corpus.tokens + trainer->corpus.offsets[w];
+    for (uint32_t i = 0; i + 1 < trainer->corpus.lengths[w]; i++) {
+      if (toks[i] == config.unk_id || toks[i + 1] == config.unk_id) continue;
+      Info* info = bimap_find(&trainer->bigram_map, {toks[i], toks[i + 1]});
+      TEST_ASSERT(!info || info->freq < config.min_pair_freq, "Dropped word still holds a mergeable pair");
+    }
+  }
+  TEST_ASSERT(ai == trainer->num_active, "Active list is not ascending");
+  bpe_train(trainer);
+  TEST_ASSERT(trainer->verify_mismatches == 0, "Recount over active words disagrees with tracked counts");
+  bpe_trainer_destroy(trainer);
+  unlink(test_file);
+  TEST_PASS("test_active_words");
+}
+
+// Test 19: Queue rebuilds & dead pair tracking
+static int test_pair_compaction() {
+  BPEHeapEntry entries[200];
+  MaxHeap built, updated;
+  heap_init(&built, MIN_HEAP_SIZE);
+  heap_init(&updated, MIN_HEAP_SIZE);
+  for (uint32_t i = 0; i < 200; i++) {
+    entries[i] = {{(int32_t)(i % 7), (int32_t)i}, (uint64_t)(i * 37 % 11), i};
+    heap_update(&updated, entries[i].key, entries[i].freq, i);
+  }
+  heap_build(&built, entries, 200);
+  while (!heap_empty(&updated)) {
+    BPEHeapEntry a = heap_pop(&updated), b = heap_pop(&built);
+    TEST_ASSERT(a.id == b.id && a.freq == b.freq, "Built heap pops in a different order");
+  }
+  TEST_ASSERT(heap_empty(&built), "Built heap has extra entries");
+  heap_free(&built);
+  heap_free(&updated);
+
+  // renumbering every 3rd pair away must keep the LIFO order of ties
+  BucketQueue q, ref;
+  bq_init(&q, 5);
+  bq_init(&ref, 5);
+  uint32_t remap[300];
+  uint32_t next_id = 0;
+  for (uint32_t i = 0; i < 300; i++) {
+    remap[i] = i % 3 ? next_id++ : UINT32_MAX;
+    if (i % 3 == 0) continue;
+    PairKey key = {(int32_t)i, 0};
+    bq_update(&q, key, i % 5 + 1, i);
+    bq_update(&ref, key, i % 5 + 1, remap[i]);
+  }
+  bq_renumber(&q, remap, 300, next_id);
+  TEST_ASSERT(q.nids < 2048 && q.size == ref.size, "Renumbered queue has the wrong size");
+  while (!bq_empty(&ref)) {
+    BPEHeapEntry a = bq_pop(&ref), b = bq_pop(&q);
+    TEST_ASSERT(a.id == b.id && a.key.first == b.key.first, "Renumbered queue pops in a different order");
+  }
+  bq_free(&q);
+  bq_free(&ref);
+
+  const char* test_file = "test_compact.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .num_threads = 1
+  };
+  Trainer* trainer = create_trainer(&config);
+  TEST_ASSERT(bpe_load_corpus(trainer, test_file) == 0, "Corpus loading failed");
+  bpe_train(trainer);
+  size_t live = 0;
+  for (size_t i = 0; i < trainer->bigram_map.cap; i++) {
+    const BIEntry* e = &trainer->bigram_map.slots[i];
+    if (e->key != BIMAP_EMPTY && e->info.freq > 0) live++;
+  }
+  TEST_ASSERT(live == trainer->live_pairs, "Live pair count drifted from the bigram map");
+  bpe_trainer_destroy(trainer);
+  unlink(test_file);
+  TEST_PASS("test_pair_compaction");
+}
+
+// --- train `path` with or without multi_merge, merges go to `ops` ---
+static size_t train_merges(const char* path, int32_t pair_queue, int32_t multi_merge, PairKey* ops, size_t* grouped, size_t* rollbacks) {
+  BPEConfig config = {
+    .target_vocab_size = 300,
+    .unk_id = -1,
+    .character_coverage = 0.99,
+    .min_pair_freq = 2,
+    .verify_every = 1,
+    .num_threads = 1,
+    .pair_queue = pair_queue
+  };
+  config.multi_merge = multi_merge;
+  Trainer* trainer = create_trainer(&config);
+  size_t n = 0;
+  if (bpe_load_corpus(trainer, path) == 0) {
+    bpe_train(trainer);
+    n = trainer->verify_mismatches ? 0 : trainer->num_merges;
+    memcpy(ops, trainer->merge_ops, n * sizeof(PairKey));
+    *grouped = trainer->grouped_merges;
+    *rollbacks = trainer->group_rollbacks;
+  }
+  bpe_trainer_destroy(trainer);
+  return n;
+}
+
+// Test 20: Grouped merges give the sequential merge order
+static int test_multi_merge() {
+  PairKey seq[300], grp[300];
+  size_t grouped = 0, rollbacks = 0;
+  const char* test_file = "test_multi.txt";
+  TEST_ASSERT(create_test_corpus(test_file), "Failed to create test corpus");
+  for (int32_t queue = PAIR_QUEUE_HEAP; queue <= PAIR_QUEUE_BUCKET; queue++) {
+    size_t n = train_merges(test_file, queue, 0, seq, &grouped, &rollbacks);
+    TEST_ASSERT(n > 0, "Sequential training failed");
+    TEST_ASSERT(train_merges(test_file, queue, 1, grp, &grouped, &rollbacks) == n, "Grouped training did a different no of merges");
+    TEST_ASSERT(memcmp(seq, grp, n * sizeof(PairKey)) == 0, "Grouped merges differ from sequential ones");
+  }
+
+  // all pairs tie at 6000; the bucket queue pops (x,a) then (c,d), but merging (x,a)
+  // queues (X,b) last, so it is the real second merge & the group has to be cut.
+  // "z" is only there to be the byte that character coverage drops
+  FILE* fp = fopen(test_file, "w");
+  TEST_ASSERT(fp != NULL, "Failed to create tie corpus");
+  for (int i = 0; i < 6000; i++) fputs("xab cd ", fp);
+  fputs("z ", fp);
+  fclose(fp);
+  size_t n = train_merges(test_file, PAIR_QUEUE_BUCKET, 0, seq, &grouped, &rollbacks);
+  TEST_ASSERT(n == 3 && train_merges(test_file, PAIR_QUEUE_BUCKET, 1, grp, &grouped, &rollbacks) == n, "Tie corpus training failed");
+  TEST_ASSERT(rollbacks > 0, "Group was not cut");
+  TEST_ASSERT(memcmp(seq, grp, n * sizeof(PairKey)) == 0, "Cut group changed the merge order");
+  unlink(test_file);
+  TEST_PASS("test_multi_merge");
+}
+
+// Test 21: Error handling
 static int test_error_handling() {
   // Test NULL config
   Trainer* trainer = create_trainer(NULL);
@@ -335,6 +984,19 @@ static TestCase tests[] = {
   {"Single Merge", test_single_merge},
   {"Full Training", test_full_training},
   {"Model Saving", test_model_saving},
+  {"Incremental Counts", test_incremental_counts},
+  {"Indexed Heap", test_indexed_heap},
+  {"Bucket Queue", test_bucket_queue},
+  {"Arena", test_arena},
+  {"Checkpoint Resume", test_checkpoint_resume},
+  {"Word Cache", test_word_cache},
+  {"Snapshots", test_snapshots},
+  {"Load Model", test_load_model},
+  {"Encoder", test_encoder},
+  {"Word Pruning", test_word_pruning},
+  {"Active Words", test_active_words},
+  {"Pair Compaction", test_pair_compaction},
+  {"Multi Merge", test_multi_merge},
   {"Error Handling", test_error_handling}
 };
 
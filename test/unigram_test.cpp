@@ -0,0 +1,451 @@
+// test case for the Unigram trainer
+// Compilation: g++ -o run unigram_test.cpp ../shredword/csrc/trie.cpp ../shredword/csrc/unigram/cache.cpp ../shredword/csrc/unigram/hashmap.cpp ../shredword/csrc/unigram/heap.cpp ../shredword/csrc/unigram/subword.cpp ../shredword/csrc/unigram/unigram.cpp -pthread
+// Usage: -> ./run
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../shredword/csrc/trie.h"
+#include "../shredword/csrc/unigram/subword.h"
+#include "../shredword/csrc/unigram/unigram.h"
+#include "../shredword/csrc/inc/threads.h"
+
+// Test utilities
+#define TEST_ASSERT(condition, message) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "[FAIL] %s: %s\n", __func__, message); \
+      return 0; \
+    } \
+  } while(0)
+
+#define TEST_PASS(test_name) \
+  do { \
+    printf("[PASS] %s\n", test_name); \
+    return 1; \
+  } while(0)
+
+// fixed point count of a posterior, allowing for the rounding of exp() in the lattice
+static int count_near(int64_t units, double expected) {
+  return llabs(units - llround(expected * EXPECTED_COUNT_ONE)) <= 2;
+}
+
+static double log_add_exp(double a, double b) {
+  double m = a > b ? a : b;
+  return m + log(exp(a - m) + exp(b - m));
+}
+
+// small vocab with scores, inserted one token at a time
+static SubwordTrie* create_test_trie(const char** tokens, const double* scores, int count) {
+  SubwordTrie* trie = trieCreate();
+  if (!trie) return NULL;
+  for (int i = 0; i < count; i++) {
+    if (!trieInsert(trie, tokens[i], i + 1) || !trieUpdateScore(trie, tokens[i], scores[i])) {
+      trieDestroy(trie);
+      return NULL;
+    }
+  }
+  return trie;
+}
+
+// Test 1: insert, search, remove & free list reuse
+static int test_trie_round_trip() {
+  SubwordTrie* trie = trieCreate();
+  TEST_ASSERT(trie != NULL, "Trie creation failed");
+  size_t empty_usage = trieMemoryUsage(trie);
+  TEST_ASSERT(empty_usage >= sizeof(SubwordTrie), "Memory usage should cover the trie itself");
+
+  const char* tokens[] = {"a", "ab", "abc", "abd", "b", "ba"};
+  for (int i = 0; i < 6; i++) TEST_ASSERT(trieInsert(trie, tokens[i], 10 + i), "Insert failed");
+  TEST_ASSERT(trieGetTokenCount(trie) == 6, "Token count should be 6");
+  for (int i = 0; i < 6; i++) TEST_ASSERT(trieSearch(trie, tokens[i]) == 10 + i, "Search should return the inserted freq");
+  TEST_ASSERT(!trieContains(trie, "abx"), "Unknown token should not be found");
+  TEST_ASSERT(!trieContains(trie, "abcd"), "Extension of a token should not be found");
+  TEST_ASSERT(trieTokenId(trie, "abx") == TRIE_NONE, "Unknown token should have no id");
+  TEST_ASSERT(trieUpdateScore(trie, "abc", -3.0), "Score update failed");
+  TEST_ASSERT(trie->nodes[trieTokenId(trie, "abc")].score == -3.0, "Score should be stored on the token node");
+  TEST_ASSERT(!trieUpdateScore(trie, "abx", -1.0), "Score update of an unknown token should fail");
+
+  int nodes_before = trie->node_count;
+  TEST_ASSERT(trieRemove(trie, "abd"), "Remove failed");
+  TEST_ASSERT(!trieRemove(trie, "abd"), "Second remove should fail");
+  TEST_ASSERT(!trieContains(trie, "abd"), "Removed token should be gone");
+  TEST_ASSERT(trieContains(trie, "abc") && trieContains(trie, "ab"), "Siblings & prefixes should survive a remove");
+  TEST_ASSERT(trie->free_list != TRIE_NONE, "Removed leaf should go on the free list");
+
+  // "ab" keeps its node (it still has a child), only its token flag goes
+  TEST_ASSERT(trieRemove(trie, "ab"), "Remove of an inner token failed");
+  TEST_ASSERT(trieContains(trie, "abc"), "Child of a removed inner token should survive");
+  TEST_ASSERT(trieGetTokenCount(trie) == 4, "Token count should be 4");
+
+  TEST_ASSERT(trieInsert(trie, "abe", 7), "Reinsert failed");
+  TEST_ASSERT(trie->node_count == nodes_before, "Insert after a remove should reuse the freed node");
+  TEST_ASSERT(trie->free_list == TRIE_NONE, "Free list should be used up");
+  TEST_ASSERT(trieSearch(trie, "abe") == 7, "Reinserted token has the wrong freq");
+
+  char** all; int* freqs; int count;
+  trieGetAllTokens(trie, &all, &freqs, &count);
+  TEST_ASSERT(count == 5, "GetAllTokens should return every token");
+  for (int i = 0; i < count; i++) free(all[i]);
+  free(all);
+  free(freqs);
+
+  trieDestroy(trie);
+  TEST_PASS("test_trie_round_trip");
+}
+
+// Test 2: bulk build gives the same trie as inserting one by one
+static int test_trie_build() {
+  const char* tokens[] = {"a", "ab", "abc", "b", "ba", "bab", "c", "cab"};
+  const int freqs[] = {5, 4, 3, 6, 2, 1, 7, 8};
+  const double scores[] = {-1.0, -2.0, -3.0, -1.5, -2.5, -3.5, -0.5, -4.0};
+  int count = 8;
+
+  SubwordTrie* built = trieCreate();
+  SubwordTrie* inserted = trieCreate();
+  TEST_ASSERT(built && inserted, "Trie creation failed");
+  TEST_ASSERT(trieBuild(built, tokens, freqs, scores, count), "Build failed");
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT(trieInsert(inserted, tokens[i], freqs[i]), "Insert failed");
+    TEST_ASSERT(trieUpdateScore(inserted, tokens[i], scores[i]), "Score update failed");
+  }
+  TEST_ASSERT(trieGetTokenCount(built) == count, "Built trie has the wrong token count");
+  TEST_ASSERT(built->node_count == inserted->node_count, "Build & insert should use the same nodes");
+  for (int i = 0; i < count; i++) {
+    uint32_t id = trieTokenId(built, tokens[i]);
+    TEST_ASSERT(id != TRIE_NONE, "Built token should have an id");
+    TEST_ASSERT(trieSearch(built, tokens[i]) == freqs[i], "Built token has the wrong freq");
+    TEST_ASSERT(built->nodes[id].score == scores[i], "Built token has the wrong score");
+  }
+  TEST_ASSERT(!trieContains(built, "ca") && !trieContains(built, "bb"), "Build should not add extra tokens");
+
+  // a built trie takes inserts & removes like any other
+  TEST_ASSERT(trieInsert(built, "bb", 9) && trieSearch(built, "bb") == 9, "Insert into a built trie failed");
+  TEST_ASSERT(trieRemove(built, "ab") && trieContains(built, "abc"), "Remove from a built trie failed");
+
+  // out of order input falls back to insert
+  SubwordTrie* unsorted = trieCreate();
+  const char* reversed[] = {"c", "b", "a"};
+  TEST_ASSERT(trieBuild(unsorted, reversed, freqs, NULL, 3), "Unsorted build failed");
+  TEST_ASSERT(trieGetTokenCount(unsorted) == 3 && trieContains(unsorted, "a"), "Unsorted build lost tokens");
+  const char* empty[] = {""};
+  TEST_ASSERT(!trieBuild(unsorted, empty, freqs, NULL, 1), "Empty token should be rejected");
+
+  trieDestroy(built);
+  trieDestroy(inserted);
+  trieDestroy(unsorted);
+  TEST_PASS("test_trie_build");
+}
+
+// Test 3: every token that prefixes the text, shortest first
+static int test_prefix_search() {
+  const char* tokens[] = {"a", "ab", "abc", "b", "ba", "bab", "c", "cab"};
+  const double scores[] = {-1.0, -2.0, -3.0, -1.5, -2.5, -3.5, -0.5, -4.0};
+  SubwordTrie* trie = create_test_trie(tokens, scores, 8);
+  TEST_ASSERT(trie != NULL, "Setup failed");
+
+  const char* texts[] = {"abcab", "babc", "cab", "x", "bx"};
+  const int expected[] = {3, 3, 2, 0, 1};
+  TrieMatch matches[MAX_TOKEN_LENGTH];
+  for (int t = 0; t < 5; t++) {
+    int len = (int)strlen(texts[t]);
+    int count = trieCommonPrefixSearch(trie, texts[t], len, matches);
+    TEST_ASSERT(count == expected[t], "Wrong no of prefix matches");
+    for (int m = 0; m < count; m++) {
+      TEST_ASSERT(m == 0 || matches[m].len > matches[m - 1].len, "Matches should come shortest first");
+      char token[MAX_TOKEN_LENGTH];
+      memcpy(token, texts[t], matches[m].len);
+      token[matches[m].len] = '\0';
+      TEST_ASSERT(matches[m].id == trieTokenId(trie, token), "Match id should be the token id");
+      TEST_ASSERT(matches[m].score == trie->nodes[matches[m].id].score, "Match should carry the token score");
+    }
+  }
+  TEST_ASSERT(trieCommonPrefixSearch(trie, "abcab", 2, matches) == 2, "Search should stop at len");
+  TEST_ASSERT(trieCommonPrefixSearch(trie, "abcab", 0, matches) == 0, "Empty range should not match");
+
+  // "ab" stops being a token but its node stays on the path to "abc"
+  TEST_ASSERT(trieRemove(trie, "ab"), "Remove failed");
+  TEST_ASSERT(trieCommonPrefixSearch(trie, "abcab", 5, matches) == 2, "Removed token should not match");
+  TEST_ASSERT(matches[0].len == 1 && matches[1].len == 3, "Matches around a removed token are wrong");
+
+  trieDestroy(trie);
+  TEST_PASS("test_prefix_search");
+}
+
+// Test 4: best segmentation over the trie lattice
+static int test_viterbi_decode() {
+  const char* tokens[] = {"a", "b", "ab", "c", "abc"};
+  const double scores[] = {-1.0, -2.0, -2.5, -1.0, -6.0};
+  SubwordTrie* trie = create_test_trie(tokens, scores, 5);
+  ViterbiDecoder* decoder = viterbiDecoderCreate();
+  TEST_ASSERT(trie && decoder, "Setup failed");
+
+  // ab|c (-3.5) beats abc (-6.0) & a|b|c (-4.0)
+  TokenList* list = viterbiDecode(decoder, "abcab", trie);
+  TEST_ASSERT(list != NULL, "Decode failed");
+  TEST_ASSERT(list->count == 3, "\"abcab\" should split into ab|c|ab");
+  TEST_ASSERT(strcmp(list->tokens[0], "ab") == 0 && strcmp(list->tokens[1], "c") == 0 && strcmp(list->tokens[2], "ab") == 0, "Wrong segmentation");
+  tokenListDestroy(list);
+
+  // a cheaper long token wins once its score changes
+  TEST_ASSERT(trieUpdateScore(trie, "abc", -3.0), "Score update failed");
+  list = viterbiDecode(decoder, "abc", trie);
+  TEST_ASSERT(list && list->count == 1 && strcmp(list->tokens[0], "abc") == 0, "Decode should follow the new score");
+  tokenListDestroy(list);
+
+  // no path covers the text: one token per byte
+  list = viterbiDecode(decoder, "azb", trie);
+  TEST_ASSERT(list && list->count == 3, "Fallback should give a token per byte");
+  TEST_ASSERT(strcmp(list->tokens[1], "z") == 0, "Unknown byte should be its own token");
+  tokenListDestroy(list);
+
+  viterbiDecoderDestroy(decoder);
+  trieDestroy(trie);
+  TEST_PASS("test_viterbi_decode");
+}
+
+// Test 5: best segmentation as spans of the text
+static int test_viterbi_spans() {
+  const char* tokens[] = {"a", "b", "ab", "c"};
+  const double scores[] = {-1.0, -2.0, -2.5, -1.0};
+  SubwordTrie* trie = create_test_trie(tokens, scores, 4);
+  ViterbiDecoder* decoder = viterbiDecoderCreate();
+  SpanList* spans = spanListCreate(1);
+  TEST_ASSERT(trie && decoder && spans, "Setup failed");
+
+  // "ab" (-2.5) beats "a" + "b" (-3.0)
+  int count = viterbiDecodeSpans(decoder, "abcab", trie, spans);
+  TEST_ASSERT(count == 3 && spans->count == 3, "\"abcab\" should split into ab|c|ab");
+  const int offsets[] = {0, 2, 3}, lengths[] = {2, 1, 2};
+  const char* expected[] = {"ab", "c", "ab"};
+  for (int i = 0; i < 3; i++) {
+    const TokenSpan* span = &spans->spans[i];
+    TEST_ASSERT(span->offset == offsets[i] && span->length == lengths[i], "Span covers the wrong bytes");
+    TEST_ASSERT(span->token_id == trieTokenId(trie, expected[i]), "Span has the wrong token id");
+    TEST_ASSERT(span->score == (lengths[i] == 2 ? -2.5 : -1.0), "Span has the wrong score");
+  }
+
+  // no full path: one span per byte, unknown bytes get TRIE_NONE
+  count = viterbiDecodeSpans(decoder, "azb", trie, spans);
+  TEST_ASSERT(count == 3, "Fallback should give a span per byte");
+  TEST_ASSERT(spans->spans[0].token_id == trieTokenId(trie, "a"), "Known byte should keep its id");
+  TEST_ASSERT(spans->spans[1].token_id == TRIE_NONE && spans->spans[1].offset == 1, "Unknown byte should have no id");
+  TEST_ASSERT(spans->spans[2].score == -2.0, "Known byte should keep its score");
+
+  // the list grows for a long text & is reused as is for shorter ones
+  char text[1001];
+  for (int i = 0; i < 1000; i++) text[i] = "abc"[i % 3];
+  text[1000] = '\0';
+  count = viterbiDecodeSpans(decoder, text, trie, spans);
+  TEST_ASSERT(count > 0 && spans->capacity >= count, "List should grow to hold every span");
+  int covered = 0;
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT(spans->spans[i].offset == covered, "Spans should tile the text");
+    covered += spans->spans[i].length;
+  }
+  TEST_ASSERT(covered == 1000, "Spans should cover the whole text");
+  TokenSpan* buffer = spans->spans;
+  int capacity = spans->capacity;
+  TEST_ASSERT(viterbiDecodeSpans(decoder, "cab", trie, spans) == 2, "\"cab\" should split into c|ab");
+  TEST_ASSERT(spans->spans == buffer && spans->capacity == capacity, "Shorter text should reuse the buffer");
+
+  TEST_ASSERT(viterbiDecodeSpans(decoder, "", trie, spans) == 0 && spans->count == 0, "Empty text should give no spans");
+  TEST_ASSERT(viterbiDecodeSpans(decoder, NULL, trie, spans) == -1, "NULL text should fail");
+
+  spanListDestroy(spans);
+  viterbiDecoderDestroy(decoder);
+  trieDestroy(trie);
+  TEST_PASS("test_viterbi_spans");
+}
+
+// trainer with its initial vocab & one E/M step over a fixed corpus (with repeated texts)
+static UnigramTrainer* create_scored_trainer(int num_threads) {
+  static const char* words[] = {"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+                                "hello", "world", "testing", "algorithm", "programming", "unigram"};
+  UnigramTrainer* trainer = trainerCreate(200, 0.9995f, 8, 5000, num_threads);
+  if (!trainer) return NULL;
+  char text[256];
+  for (int i = 0; i < 600; i++) {
+    snprintf(text, sizeof(text), "%s %s %s %s", words[i % 14], words[(i * 3 + 1) % 14], words[(i * 7 + 2) % 14], words[(i / 14) % 14]);
+    addTextToTrainer(trainer, text);
+  }
+  if (!preprocessTexts(trainer) || !extractInitialSubwords(trainer) ||
+      !updateTokenScores(trainer, (const char**)trainer->texts, trainer->text_count)) {
+    trainerDestroy(trainer);
+    return NULL;
+  }
+  return trainer;
+}
+
+// Test 6: the E-step gives bit identical scores for any no of threads
+static int test_update_scores_threads() {
+  UnigramTrainer* serial = create_scored_trainer(1);
+  UnigramTrainer* threaded = create_scored_trainer(4);
+  TEST_ASSERT(serial && threaded, "Trainer setup failed");
+  TEST_ASSERT(threads_for((size_t)threaded->text_count, threaded->num_threads, MIN_TEXTS_PER_THREAD) > 1, "Corpus too small to use threads");
+  TEST_ASSERT(hashMapSize(serial->vocab) == hashMapSize(threaded->vocab), "Vocab sizes differ");
+
+  HashMapIterator* iter = hashMapIteratorCreate(serial->vocab);
+  TEST_ASSERT(iter != NULL, "Iterator creation failed");
+  const char* key; void* value;
+  int compared = 0, same = 1;
+  while (hashMapIteratorNext(iter, &key, &value)) {
+    double* other = (double*)hashMapGet(threaded->vocab, key);
+    if (!other || memcmp(value, other, sizeof(double)) != 0) same = 0;
+    compared++;
+  }
+  hashMapIteratorDestroy(iter);
+  TEST_ASSERT(compared > 0, "Vocab should not be empty");
+  TEST_ASSERT(same, "Scores differ between 1 & 4 threads");
+
+  trainerDestroy(serial);
+  trainerDestroy(threaded);
+  TEST_PASS("test_update_scores_threads");
+}
+
+// Test 7: the loss is the same for any no of threads, from a cold & a warm cache
+static int test_compute_loss_threads() {
+  UnigramTrainer* serial = create_scored_trainer(1);
+  UnigramTrainer* threaded = create_scored_trainer(4);
+  TEST_ASSERT(serial && threaded, "Trainer setup failed");
+  int count = serial->text_count;
+  TEST_ASSERT(count == threaded->text_count, "Text counts differ");
+  TEST_ASSERT(threads_for((size_t)count, threaded->num_threads, MIN_TEXTS_PER_THREAD) > 1, "Corpus too small to use threads");
+
+  float cold_serial = computeLoss(serial, (const char**)serial->texts, count);
+  float cold_threaded = computeLoss(threaded, (const char**)threaded->texts, count);
+  TEST_ASSERT(cold_serial > 0.0f, "Loss should be positive");
+  TEST_ASSERT(cold_serial == cold_threaded, "Cold cache loss differs between 1 & 4 threads");
+
+  // second pass hits the cache for every text
+  float warm_serial = computeLoss(serial, (const char**)serial->texts, count);
+  float warm_threaded = computeLoss(threaded, (const char**)threaded->texts, count);
+  TEST_ASSERT(warm_serial == warm_threaded, "Warm cache loss differs between 1 & 4 threads");
+  TEST_ASSERT(fabs(warm_serial - cold_serial) < 1e-2, "Cached loss should match the decoded one");
+
+  // a half warm cache: the first half is cached, the rest (& its repeats) is decoded
+  cacheFree(serial->loss_cache), serial->loss_cache = cacheCreate(100000);
+  cacheFree(threaded->loss_cache), threaded->loss_cache = cacheCreate(100000);
+  computeLoss(serial, (const char**)serial->texts, count / 2);
+  computeLoss(threaded, (const char**)threaded->texts, count / 2);
+  float mixed_serial = computeLoss(serial, (const char**)serial->texts, count);
+  float mixed_threaded = computeLoss(threaded, (const char**)threaded->texts, count);
+  TEST_ASSERT(mixed_serial == mixed_threaded, "Half warm cache loss differs between 1 & 4 threads");
+
+  trainerDestroy(serial);
+  trainerDestroy(threaded);
+  TEST_PASS("test_compute_loss_threads");
+}
+
+// Test 8: posteriors on a lattice small enough to work out by hand
+static int test_forward_backward() {
+  const char* tokens[] = {"a", "b", "ab"};
+  const double scores[] = {-1.0, -2.0, -2.5};
+  SubwordTrie* trie = create_test_trie(tokens, scores, 3);
+  ViterbiDecoder* decoder = viterbiDecoderCreate();
+  TEST_ASSERT(trie && decoder, "Setup failed");
+  uint32_t a = trieTokenId(trie, "a"), b = trieTokenId(trie, "b"), ab = trieTokenId(trie, "ab");
+
+  // "ab" has two paths: a|b (-3.0) & ab (-2.5)
+  int64_t* counts = (int64_t*)calloc(trie->node_count, sizeof(int64_t));
+  TEST_ASSERT(counts != NULL, "Allocation failed");
+  double log_z = forwardBackward(decoder, "ab", trie, counts);
+  double expected_z = log_add_exp(-3.0, -2.5);
+  TEST_ASSERT(fabs(log_z - expected_z) < 1e-12, "log Z should be logaddexp(-3.0, -2.5)");
+  double p_split = exp(-3.0 - expected_z), p_whole = exp(-2.5 - expected_z);
+  TEST_ASSERT(count_near(counts[a], p_split), "Expected count of a is wrong");
+  TEST_ASSERT(count_near(counts[b], p_split), "Expected count of b is wrong");
+  TEST_ASSERT(count_near(counts[ab], p_whole), "Expected count of ab is wrong");
+  TEST_ASSERT(llabs(counts[a] + counts[ab] - (int64_t)EXPECTED_COUNT_ONE) <= 2, "Byte 0 should be covered exactly once");
+
+  // counts accumulate over calls: "aab" = a|a|b or a|ab
+  memset(counts, 0, trie->node_count * sizeof(int64_t));
+  forwardBackward(decoder, "ab", trie, counts);
+  log_z = forwardBackward(decoder, "aab", trie, counts);
+  double z2 = log_add_exp(-4.0, -3.5);
+  TEST_ASSERT(fabs(log_z - z2) < 1e-12, "log Z of \"aab\" is wrong");
+  TEST_ASSERT(count_near(counts[a], p_split + 1.0 + exp(-4.0 - z2)), "Counts should add up over texts");
+  TEST_ASSERT(count_near(counts[ab], p_whole + exp(-3.5 - z2)), "Counts should add up over texts");
+
+  TEST_ASSERT(isnan(forwardBackward(decoder, NULL, trie, counts)), "NULL text should give NAN");
+  TEST_ASSERT(forwardBackward(decoder, "", trie, counts) == 0.0, "Empty text should have log Z of 0");
+
+  free(counts);
+  viterbiDecoderDestroy(decoder);
+  trieDestroy(trie);
+  TEST_PASS("test_forward_backward");
+}
+
+// Test 9: no path covers the text, every known byte counts once
+static int test_forward_backward_fallback() {
+  const char* tokens[] = {"a", "b", "ab"};
+  const double scores[] = {-1.0, -2.0, -2.5};
+  SubwordTrie* trie = create_test_trie(tokens, scores, 3);
+  ViterbiDecoder* decoder = viterbiDecoderCreate();
+  int64_t* counts = trie ? (int64_t*)calloc(trie->node_count, sizeof(int64_t)) : NULL;
+  TEST_ASSERT(trie && decoder && counts, "Setup failed");
+
+  double log_z = forwardBackward(decoder, "abzab", trie, counts);
+  TEST_ASSERT(log_z == -INFINITY, "Text with an unknown byte should have no path");
+  int64_t one = (int64_t)EXPECTED_COUNT_ONE;
+  TEST_ASSERT(counts[trieTokenId(trie, "a")] == 2 * one, "Each \"a\" byte should count once");
+  TEST_ASSERT(counts[trieTokenId(trie, "b")] == 2 * one, "Each \"b\" byte should count once");
+  TEST_ASSERT(counts[trieTokenId(trie, "ab")] == 0, "Multi byte tokens should not count in the fallback");
+
+  free(counts);
+  viterbiDecoderDestroy(decoder);
+  trieDestroy(trie);
+  TEST_PASS("test_forward_backward_fallback");
+}
+
+typedef struct {
+  const char* name;
+  int (*func)();
+} TestCase;
+
+static TestCase tests[] = {
+  {"Trie Round Trip", test_trie_round_trip},
+  {"Trie Build", test_trie_build},
+  {"Prefix Search", test_prefix_search},
+  {"Viterbi Decode", test_viterbi_decode},
+  {"Viterbi Spans", test_viterbi_spans},
+  {"Update Scores Threads", test_update_scores_threads},
+  {"Compute Loss Threads", test_compute_loss_threads},
+  {"Forward Backward", test_forward_backward},
+  {"Forward Backward Fallback", test_forward_backward_fallback}
+};
+
+int main() {
+  printf("=== Unigram Trainer Test Suite ===\n\n");
+
+  int total_tests = sizeof(tests) / sizeof(TestCase);
+  int passed = 0;
+  int failed = 0;
+
+  for (int i = 0; i < total_tests; i++) {
+    printf("Running test %d/%d: %s\n", i + 1, total_tests, tests[i].name);
+
+    if (tests[i].func()) {
+      passed++;
+    } else {
+      failed++;
+      printf("[FAIL] Test failed: %s\n", tests[i].name);
+    }
+    printf("\n");
+  }
+
+  printf("=== Test Results ===\n");
+  printf("Total tests: %d\n", total_tests);
+  printf("Passed: %d\n", passed);
+  printf("Failed: %d\n", failed);
+  printf("Success rate: %.1f%%\n", 100.0 * passed / total_tests);
+
+  if (failed == 0) {
+    printf("\n All tests passed!\n");
+    return 0;
+  } else {
+    printf("\n Some tests failed.\n");
+    return 1;
+  }
+}